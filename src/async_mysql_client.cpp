@@ -0,0 +1,321 @@
+#include "async_mysql_client.h"
+#include "logger.h"
+#include "query_stats.h"
+#include <utility>
+
+// Мод и его медиа одним запросом, чтобы поиск занимал один round-trip.
+// Неблокирующий API не поддерживает подготовленные запросы; id подставляется числом
+static const std::string ASYNC_MOD_BY_ID_SQL =
+    "SELECT m.id, m.name, m.description, m.link, m.category, m.downloads, m.views, mm.media_link "
+    "FROM mods m LEFT JOIN mod_media mm ON mm.mod_id = m.id WHERE m.id = ";
+
+// Коды ошибок клиента (CR_*, от 2000) означают проблемы соединения; ошибки сервера - нет
+static constexpr unsigned int CLIENT_ERROR_MIN = 2000;
+
+// Дескриптор сокета соединения; -1, пока его ещё нет
+static int connection_socket(MYSQL* mysql) {
+#ifdef MODSERVER_HAVE_MYSQL_GET_SOCKET
+    return static_cast<int>(mysql_get_socket(mysql));
+#else
+    // В libmysqlclient публичного аксессора нет; MYSQL::net объявлена в mysql.h,
+    // поэтому обращение к полю изолировано здесь
+    return mysql->net.fd;
+#endif
+}
+
+AsyncMySqlClient::AsyncMySqlClient(boost::asio::io_context& io_context, const PoolOptions& connection,
+                                   const AsyncClientOptions& options)
+    : strand_(boost::asio::make_strand(io_context)), connection_options_(connection), options_(options) {
+    if (options_.connections == 0) {
+        options_.connections = 1;
+    }
+    for (std::size_t i = 0; i < options_.connections; ++i) {
+        auto conn = std::make_unique<Connection>(io_context);
+        conn->id = static_cast<unsigned>(i + 1);
+        connections_.push_back(std::move(conn));
+    }
+}
+
+AsyncMySqlClient::~AsyncMySqlClient() {
+    for (auto& conn : connections_) {
+        closeConnection(*conn);
+    }
+}
+
+void AsyncMySqlClient::start() {
+    boost::asio::post(strand_, [this]() {
+        for (auto& conn : connections_) {
+            connect(*conn);
+        }
+    });
+}
+
+bool AsyncMySqlClient::getModById(int mod_id, LookupCallback callback) {
+    if (outstanding_.fetch_add(1) >= options_.queue_limit) {
+        --outstanding_;
+        return false;
+    }
+
+    boost::asio::post(strand_, [this, mod_id, callback = std::move(callback)]() mutable {
+        pending_.push_back(Lookup{mod_id, std::move(callback)});
+        dispatchPending();
+        failPendingIfDisconnected();
+    });
+    return true;
+}
+
+void AsyncMySqlClient::connect(Connection& conn) {
+    conn.mysql = mysql_init(nullptr);
+    if (!conn.mysql) {
+        log_message("Async MySQL: error initializing connection #" + std::to_string(conn.id), "ERROR");
+        resetConnection(conn, "mysql_init failed");
+        return;
+    }
+
+    unsigned int timeout = static_cast<unsigned int>(
+        std::chrono::duration_cast<std::chrono::seconds>(options_.query_timeout).count() + 1);
+    mysql_options(conn.mysql, MYSQL_OPT_CONNECT_TIMEOUT, &timeout);
+
+    conn.state = Connection::State::Connecting;
+    conn.handshake = false;
+    conn.started = std::chrono::steady_clock::now();
+    ++conn.ticket;
+    armTimeout(conn);
+    continueConnect(conn);
+}
+
+void AsyncMySqlClient::continueConnect(Connection& conn) {
+    net_async_status status = mysql_real_connect_nonblocking(
+        conn.mysql, connection_options_.host.c_str(), connection_options_.user.c_str(),
+        connection_options_.password.c_str(), connection_options_.db_name.c_str(), 0, nullptr, 0);
+
+    if (status == NET_ASYNC_ERROR) {
+        resetConnection(conn, "connect failed: " + std::string(mysql_error(conn.mysql)));
+        return;
+    }
+
+    // Сокет появляется после первого шага подключения
+    int fd = connection_socket(conn.mysql);
+    if (!conn.socket.is_open() && fd >= 0) {
+        boost::system::error_code ec;
+        conn.socket.assign(fd, ec);
+        if (ec) {
+            resetConnection(conn, "cannot watch socket: " + ec.message());
+            return;
+        }
+    }
+
+    if (status == NET_ASYNC_NOT_READY) {
+        // Пока идёт TCP-подключение, ждём возможности писать; дальше рукопожатие ждёт ответов сервера
+        auto wait = conn.handshake ? boost::asio::posix::stream_descriptor::wait_read
+                                   : boost::asio::posix::stream_descriptor::wait_write;
+        conn.handshake = true;
+        waitSocket(conn, wait, &AsyncMySqlClient::continueConnect);
+        return;
+    }
+
+    conn.timer.cancel();
+    recordQuery(conn, true, 0);
+    conn.state = Connection::State::Idle;
+    log_message("Async MySQL connection #" + std::to_string(conn.id) + " established", "INFO");
+    dispatchPending();
+}
+
+void AsyncMySqlClient::runLookup(Connection& conn, Lookup lookup) {
+    conn.state = Connection::State::Busy;
+    conn.sql = ASYNC_MOD_BY_ID_SQL + std::to_string(lookup.mod_id);
+    conn.lookup = std::move(lookup);
+    conn.started = std::chrono::steady_clock::now();
+    ++conn.ticket;
+    armTimeout(conn);
+    continueQuery(conn);
+}
+
+void AsyncMySqlClient::continueQuery(Connection& conn) {
+    // Повторные вызовы с теми же аргументами продолжают начатую отправку и чтение ответа
+    net_async_status status = mysql_real_query_nonblocking(
+        conn.mysql, conn.sql.c_str(), static_cast<unsigned long>(conn.sql.size()));
+
+    if (status == NET_ASYNC_NOT_READY) {
+        // Короткий запрос уходит в буфер сокета сразу, дальше ждём ответа сервера
+        waitSocket(conn, boost::asio::posix::stream_descriptor::wait_read, &AsyncMySqlClient::continueQuery);
+        return;
+    }
+    if (status == NET_ASYNC_ERROR) {
+        unsigned int err = mysql_errno(conn.mysql);
+        if (err >= CLIENT_ERROR_MIN) {
+            resetConnection(conn, "query failed: " + std::string(mysql_error(conn.mysql)));
+            return;
+        }
+        log_message("Async MySQL query error: " + std::string(mysql_error(conn.mysql)), "ERROR");
+        finishLookup(conn, false, std::nullopt);
+        return;
+    }
+
+    continueStore(conn);
+}
+
+void AsyncMySqlClient::continueStore(Connection& conn) {
+    MYSQL_RES* result = nullptr;
+    net_async_status status = mysql_store_result_nonblocking(conn.mysql, &result);
+
+    if (status == NET_ASYNC_NOT_READY) {
+        waitSocket(conn, boost::asio::posix::stream_descriptor::wait_read, &AsyncMySqlClient::continueStore);
+        return;
+    }
+    if (status == NET_ASYNC_ERROR || !result) {
+        resetConnection(conn, "reading result failed: " + std::string(mysql_error(conn.mysql)));
+        return;
+    }
+
+    // Результат уже целиком в памяти клиента, чтение строк не блокируется
+    std::optional<ModData> mod;
+    MYSQL_ROW row;
+    while ((row = mysql_fetch_row(result))) {
+        if (!mod) {
+            mod.emplace();
+            mod->id = row[0] ? std::stoi(row[0]) : 0;
+            mod->name = row[1] ? row[1] : "";
+            mod->description = row[2] ? row[2] : "";
+            mod->link = row[3] ? row[3] : "";
+            mod->category = row[4] ? row[4] : "Общее";
+            mod->downloads = row[5] ? std::stoull(row[5]) : 0;
+            mod->views = row[6] ? std::stoull(row[6]) : 0;
+        }
+        if (row[7]) {
+            mod->media_links.emplace_back(row[7]);
+        }
+    }
+    mysql_free_result(result);
+
+    finishLookup(conn, true, std::move(mod));
+}
+
+void AsyncMySqlClient::waitSocket(Connection& conn, boost::asio::posix::stream_descriptor::wait_type type, Step step) {
+    unsigned long long ticket = conn.ticket;
+    conn.socket.async_wait(type, boost::asio::bind_executor(strand_,
+        [this, &conn, ticket, step](const boost::system::error_code& ec) {
+            // Операция прервана таймаутом или соединение уже переоткрыто
+            if (ec || ticket != conn.ticket) {
+                return;
+            }
+            (this->*step)(conn);
+        }));
+}
+
+void AsyncMySqlClient::armTimeout(Connection& conn) {
+    unsigned long long ticket = conn.ticket;
+    conn.timer.expires_after(options_.query_timeout);
+    conn.timer.async_wait(boost::asio::bind_executor(strand_,
+        [this, &conn, ticket](const boost::system::error_code& ec) {
+            if (ec || ticket != conn.ticket) {
+                return;
+            }
+            resetConnection(conn, "operation timed out");
+        }));
+}
+
+void AsyncMySqlClient::recordQuery(Connection& conn, bool ok, std::uint64_t rows) {
+    QueryKind kind;
+    const char* sql;
+    if (conn.state == Connection::State::Connecting) {
+        kind = QueryKind::Connect;
+        sql = "CONNECT";
+    } else if (conn.state == Connection::State::Busy) {
+        kind = QueryKind::ById;
+        sql = conn.sql.c_str();
+    } else {
+        return;
+    }
+
+    auto duration = std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - conn.started);
+    query_stats().record(kind, sql, duration, rows, conn.mysql ? mysql_thread_id(conn.mysql) : 0, ok);
+}
+
+void AsyncMySqlClient::finishLookup(Connection& conn, bool ok, std::optional<ModData>&& mod) {
+    conn.timer.cancel();
+    recordQuery(conn, ok, mod ? 1 : 0);
+    ++conn.ticket;
+    conn.sql.clear();
+    conn.state = Connection::State::Idle;
+
+    if (conn.lookup) {
+        Lookup lookup = std::move(*conn.lookup);
+        conn.lookup.reset();
+        --outstanding_;
+        lookup.callback(ok, std::move(mod));
+    }
+    dispatchPending();
+}
+
+void AsyncMySqlClient::resetConnection(Connection& conn, const std::string& reason) {
+    log_message("Async MySQL connection #" + std::to_string(conn.id) + " reset: " + reason, "WARNING");
+
+    ++conn.ticket;
+    conn.timer.cancel();
+    recordQuery(conn, false, 0);
+    closeConnection(conn);
+
+    if (conn.lookup) {
+        Lookup lookup = std::move(*conn.lookup);
+        conn.lookup.reset();
+        --outstanding_;
+        lookup.callback(false, std::nullopt);
+    }
+
+    unsigned long long ticket = conn.ticket;
+    conn.timer.expires_after(RECONNECT_DELAY);
+    conn.timer.async_wait(boost::asio::bind_executor(strand_,
+        [this, &conn, ticket](const boost::system::error_code& ec) {
+            if (ec || ticket != conn.ticket) {
+                return;
+            }
+            connect(conn);
+        }));
+
+    failPendingIfDisconnected();
+}
+
+void AsyncMySqlClient::closeConnection(Connection& conn) {
+    if (conn.socket.is_open()) {
+        boost::system::error_code ignored_ec;
+        conn.socket.cancel(ignored_ec);
+        // Дескриптор закроет mysql_close
+        conn.socket.release();
+    }
+    if (conn.mysql) {
+        mysql_close(conn.mysql);
+        conn.mysql = nullptr;
+    }
+    conn.sql.clear();
+    conn.state = Connection::State::Closed;
+}
+
+void AsyncMySqlClient::dispatchPending() {
+    for (auto& conn : connections_) {
+        if (pending_.empty()) {
+            return;
+        }
+        if (conn->state == Connection::State::Idle) {
+            Lookup lookup = std::move(pending_.front());
+            pending_.pop_front();
+            runLookup(*conn, std::move(lookup));
+        }
+    }
+}
+
+void AsyncMySqlClient::failPendingIfDisconnected() {
+    for (const auto& conn : connections_) {
+        if (conn->state != Connection::State::Closed) {
+            return;
+        }
+    }
+
+    auto failed = std::move(pending_);
+    pending_.clear();
+    for (auto& lookup : failed) {
+        --outstanding_;
+        lookup.callback(false, std::nullopt);
+    }
+}
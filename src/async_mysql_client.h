@@ -0,0 +1,108 @@
+#ifndef ASYNC_MYSQL_CLIENT_H
+#define ASYNC_MYSQL_CLIENT_H
+
+#include <boost/asio.hpp>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+#include <mysql.h>
+#include "connection_pool.h"
+#include "mod_storage.h"
+
+struct AsyncClientOptions {
+    // Соединений с MySQL; по каждому одновременно идёт один запрос
+    std::size_t connections = 4;
+    // Сколько запросов может ждать свободного соединения
+    std::size_t queue_limit = 4096;
+    // Предельное время подключения или запроса, после него соединение переоткрывается
+    std::chrono::milliseconds query_timeout{5000};
+};
+
+// Клиент MySQL поверх неблокирующего C API (mysql_*_nonblocking, MySQL 8.0.16+).
+// Собирается, только если CMake нашёл этот API в клиентской библиотеке (MODSERVER_WITH_ASYNC_MYSQL).
+// Вызовы API продвигаются из io_context по готовности сокета соединения,
+// поэтому ожидающие ответа запросы не занимают потоки: несколько соединений
+// обслуживают очередь из тысяч поисков, а всё состояние живёт в одном strand.
+class AsyncMySqlClient : public AsyncModSource {
+public:
+    AsyncMySqlClient(boost::asio::io_context& io_context, const PoolOptions& connection,
+                     const AsyncClientOptions& options);
+    ~AsyncMySqlClient() override;
+
+    AsyncMySqlClient(const AsyncMySqlClient&) = delete;
+    AsyncMySqlClient& operator=(const AsyncMySqlClient&) = delete;
+
+    // Начинает открывать соединения; запросы, пришедшие раньше, ждут в очереди
+    void start();
+
+    bool getModById(int mod_id, LookupCallback callback) override;
+
+private:
+    struct Lookup {
+        int mod_id = 0;
+        LookupCallback callback;
+    };
+
+    struct Connection {
+        enum class State { Closed, Connecting, Idle, Busy };
+
+        explicit Connection(boost::asio::io_context& io_context)
+            : socket(io_context), timer(io_context) {}
+
+        unsigned id = 0;
+        MYSQL* mysql = nullptr;
+        State state = State::Closed;
+        // TCP-подключение установлено, идёт рукопожатие MySQL
+        bool handshake = false;
+        // Сокет MySQL, зарегистрированный в io_context только для ожидания готовности;
+        // владеет им libmysqlclient, поэтому перед закрытием дескриптор отпускается
+        boost::asio::posix::stream_descriptor socket;
+        // Таймаут текущей операции либо задержка перед переподключением
+        boost::asio::steady_timer timer;
+        // Номер текущей операции: обработчики от прерванных операций по нему отбрасываются
+        unsigned long long ticket = 0;
+        // Начало текущего подключения или запроса, для статистики обращений к БД
+        std::chrono::steady_clock::time_point started;
+        std::string sql;
+        std::optional<Lookup> lookup;
+    };
+
+    using Step = void (AsyncMySqlClient::*)(Connection&);
+
+    void connect(Connection& conn);
+    void continueConnect(Connection& conn);
+    void runLookup(Connection& conn, Lookup lookup);
+    void continueQuery(Connection& conn);
+    void continueStore(Connection& conn);
+    // Записывает в статистику завершение текущего подключения или запроса
+    void recordQuery(Connection& conn, bool ok, std::uint64_t rows);
+
+    // Ждёт готовности сокета и повторяет шаг, если операция всё ещё актуальна
+    void waitSocket(Connection& conn, boost::asio::posix::stream_descriptor::wait_type type, Step step);
+    void armTimeout(Connection& conn);
+    void finishLookup(Connection& conn, bool ok, std::optional<ModData>&& mod);
+    // Закрывает соединение (текущий запрос завершается ошибкой) и планирует переподключение
+    void resetConnection(Connection& conn, const std::string& reason);
+    void closeConnection(Connection& conn);
+    void dispatchPending();
+    // Нет ни одного живого соединения - очередь не дождётся ответа, отвечаем ошибкой сразу
+    void failPendingIfDisconnected();
+
+    boost::asio::strand<boost::asio::io_context::executor_type> strand_;
+    PoolOptions connection_options_;
+    AsyncClientOptions options_;
+    std::vector<std::unique_ptr<Connection>> connections_;
+    std::deque<Lookup> pending_;
+    // Запросы в очереди и в работе; проверяется без захода в strand
+    std::atomic<std::size_t> outstanding_{0};
+
+    static constexpr auto RECONNECT_DELAY = std::chrono::seconds(1);
+};
+
+#endif // ASYNC_MYSQL_CLIENT_H
@@ -0,0 +1,464 @@
+#include "catalog.h"
+#include "mod_json.h"
+#include "logger.h"
+#include <algorithm>
+#include <iterator>
+#include <unordered_set>
+
+namespace {
+
+// Модов в куске ответа GET_ALL_MODS. Кусок держит от CHUNK_MODS до 2 * CHUNK_MODS модов,
+// меньше - только если меньше весь каталог или из куска удаляли моды
+constexpr std::size_t CHUNK_MODS = 256;
+
+bool entry_less(const std::shared_ptr<const CatalogEntry>& a, const std::shared_ptr<const CatalogEntry>& b) {
+    return a->mod.id < b->mod.id;
+}
+
+void append_mod(std::string& response, const CatalogEntry& entry, FieldMask fields) {
+    response += fields == DEFAULT_FIELDS ? entry.json : mod_to_json(entry.mod, fields).dump();
+}
+
+// Закрывает страницу: курсор есть, только если после страницы остались моды
+void finish_page(std::string& response, const CatalogEntry* last, bool has_more, bool stale) {
+    response += "],\"next_cursor\":";
+    response += (has_more && last) ? std::to_string(last->mod.id) : "null";
+    if (stale) {
+        response += ",\"stale\":true";
+    }
+    response += "}\n";
+}
+
+// Записи base с наложенными изменениями. Мод, который есть в выборке изменений, существует
+// сейчас в таблице, поэтому его запись заменяется, даже если для id есть и надгробие
+std::vector<std::shared_ptr<const CatalogEntry>> merge_changes(
+        const CatalogSnapshot& base, const std::vector<std::shared_ptr<const CatalogEntry>>& updated,
+        const std::vector<int>& deleted) {
+    std::unordered_set<int> replaced(deleted.begin(), deleted.end());
+    for (const auto& entry : updated) {
+        replaced.insert(entry->mod.id);
+    }
+
+    std::vector<std::shared_ptr<const CatalogEntry>> kept;
+    kept.reserve(base.entries.size());
+    for (const auto& entry : base.entries) {
+        if (replaced.find(entry->mod.id) == replaced.end()) {
+            kept.push_back(entry);
+        }
+    }
+
+    std::vector<std::shared_ptr<const CatalogEntry>> entries;
+    entries.reserve(kept.size() + updated.size());
+    std::merge(kept.begin(), kept.end(), updated.begin(), updated.end(),
+               std::back_inserter(entries), entry_less);
+    return entries;
+}
+
+// Изменения не затрагивают индексы base: набор id тот же, а название, описание
+// и категория изменённых модов прежние (поменялись, например, ссылка, медиа или счётчики)
+bool same_indexed_mods(const CatalogSnapshot& base, const std::vector<std::shared_ptr<const CatalogEntry>>& updated,
+                       const std::vector<int>& deleted) {
+    std::unordered_set<int> updated_ids;
+    for (const auto& entry : updated) {
+        updated_ids.insert(entry->mod.id);
+        const ModData* old = base.find(entry->mod.id);
+        if (!old || old->name != entry->mod.name || old->description != entry->mod.description ||
+            old->category != entry->mod.category) {
+            return false;
+        }
+    }
+    for (int mod_id : deleted) {
+        if (!updated_ids.count(mod_id) && base.find(mod_id)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Нарезает записи [begin, end) на куски. Вставка одного мода в кусок не дробит его:
+// остаток от деления распределяется по кускам, а не выделяется в отдельный маленький
+void append_chunks(std::vector<std::shared_ptr<const CatalogChunk>>& chunks,
+                   const std::vector<std::shared_ptr<const CatalogEntry>>& entries,
+                   std::size_t begin, std::size_t end) {
+    std::size_t count = end - begin;
+    if (count == 0) {
+        return;
+    }
+    std::size_t pieces = std::max<std::size_t>(1, count / CHUNK_MODS);
+    for (std::size_t piece = 0; piece < pieces; ++piece) {
+        std::size_t size = count / pieces + (piece < count % pieces ? 1 : 0);
+        chunks.push_back(std::make_shared<const CatalogChunk>(
+            entries.begin() + static_cast<std::ptrdiff_t>(begin), size));
+        begin += size;
+    }
+}
+
+// Куски ответа для entries - записей base с наложенными изменениями модов changed
+// (id по возрастанию, без повторов). Кусок base отвечает за id после последнего мода
+// предыдущего куска и до своего последнего мода включительно, последний кусок - и за все
+// id дальше. Куски, в чей диапазон не попал ни один изменённый id, переходят как есть
+std::vector<std::shared_ptr<const CatalogChunk>> patch_chunks(
+        const CatalogSnapshot& base, const std::vector<std::shared_ptr<const CatalogEntry>>& entries,
+        const std::vector<int>& changed) {
+    std::vector<std::shared_ptr<const CatalogChunk>> chunks;
+    if (base.chunks.empty()) {
+        append_chunks(chunks, entries, 0, entries.size());
+        return chunks;
+    }
+
+    chunks.reserve(base.chunks.size() + 1);
+    std::size_t position = 0;
+    auto next_changed = changed.begin();
+    for (std::size_t i = 0; i < base.chunks.size(); ++i) {
+        const auto& chunk = base.chunks[i];
+        bool last = i + 1 == base.chunks.size();
+        auto changed_end = last ? changed.end() : std::upper_bound(next_changed, changed.end(), chunk->lastId());
+        if (changed_end == next_changed) {
+            chunks.push_back(chunk);
+            position += chunk->mods();
+            continue;
+        }
+        next_changed = changed_end;
+
+        std::size_t end = entries.size();
+        if (!last) {
+            end = static_cast<std::size_t>(std::upper_bound(
+                entries.begin() + static_cast<std::ptrdiff_t>(position), entries.end(), chunk->lastId(),
+                [](int id, const std::shared_ptr<const CatalogEntry>& entry) { return id < entry->mod.id; }) -
+                entries.begin());
+        }
+        append_chunks(chunks, entries, position, end);
+        position = end;
+    }
+    return chunks;
+}
+
+std::vector<int> changed_ids(const std::vector<std::shared_ptr<const CatalogEntry>>& updated,
+                             const std::vector<int>& deleted) {
+    std::vector<int> ids(deleted);
+    for (const auto& entry : updated) {
+        ids.push_back(entry->mod.id);
+    }
+    std::sort(ids.begin(), ids.end());
+    ids.erase(std::unique(ids.begin(), ids.end()), ids.end());
+    return ids;
+}
+
+std::shared_ptr<const CategoryIndex> build_category_index(const std::vector<std::shared_ptr<const CatalogEntry>>& entries) {
+    auto index = std::make_shared<CategoryIndex>();
+    for (std::size_t i = 0; i < entries.size(); ++i) {
+        index->mods[entries[i]->mod.category].push_back(static_cast<std::uint32_t>(i));
+    }
+
+    nlohmann::json categories = nlohmann::json::array();
+    for (const auto& [name, positions] : index->mods) {
+        categories.push_back({{"name", name}, {"count", positions.size()}});
+    }
+    index->json = categories.dump();
+    return index;
+}
+
+std::shared_ptr<const SearchIndex> build_search_index(const std::vector<std::shared_ptr<const CatalogEntry>>& entries) {
+    auto started = std::chrono::steady_clock::now();
+    auto index = std::make_shared<SearchIndex>();
+    for (const auto& entry : entries) {
+        index->add(entry->mod.name, entry->mod.description);
+    }
+    index->finalize();
+
+    auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - started);
+    log_message("Search index built: " + std::to_string(index->documents()) + " mods, " +
+                std::to_string(index->terms()) + " terms in " + std::to_string(elapsed.count()) + " ms", "DEBUG");
+    return index;
+}
+
+} // namespace
+
+std::shared_ptr<const CatalogEntry> CatalogSnapshot::entry(int mod_id) const {
+    auto it = std::lower_bound(entries.begin(), entries.end(), mod_id,
+        [](const std::shared_ptr<const CatalogEntry>& entry, int id) { return entry->mod.id < id; });
+    if (it == entries.end() || (*it)->mod.id != mod_id) {
+        return nullptr;
+    }
+    return *it;
+}
+
+const ModData* CatalogSnapshot::find(int mod_id) const {
+    auto found = entry(mod_id);
+    return found ? &found->mod : nullptr;
+}
+
+CatalogChunk::CatalogChunk(std::vector<std::shared_ptr<const CatalogEntry>>::const_iterator first,
+                           std::size_t count)
+    : entries_(first, first + static_cast<std::ptrdiff_t>(count)) {
+    // Кусок собирается из готовых JSON модов, повторной сериализации нет
+    std::size_t total = 0;
+    for (const auto& entry : entries_) {
+        total += entry->json.size() + 1;
+    }
+    std::string json;
+    json.reserve(total);
+    for (std::size_t i = 0; i < entries_.size(); ++i) {
+        if (i > 0) json += ',';
+        json += entries_[i]->json;
+    }
+    json_ = std::make_shared<const std::string>(std::move(json));
+}
+
+std::shared_ptr<const std::string> CatalogChunk::json(FieldMask fields) const {
+    if (fields == DEFAULT_FIELDS) {
+        return json_;
+    }
+
+    // Одновременные запросы с той же маской ждут одну сборку, а не строят каждый свою
+    std::lock_guard<std::mutex> lock(projections_mutex_);
+    auto it = projections_.find(fields);
+    if (it != projections_.end()) {
+        return it->second;
+    }
+
+    std::string json;
+    for (std::size_t i = 0; i < entries_.size(); ++i) {
+        if (i > 0) json += ',';
+        json += mod_to_json(entries_[i]->mod, fields).dump();
+    }
+    auto shared = std::make_shared<const std::string>(std::move(json));
+    projections_.emplace(fields, shared);
+    return shared;
+}
+
+ResponseParts CatalogSnapshot::allModsResponse(FieldMask fields) const {
+    static const auto open = std::make_shared<const std::string>("[");
+    static const auto separator = std::make_shared<const std::string>(",");
+    static const auto close = std::make_shared<const std::string>("]\n");
+
+    ResponseParts parts;
+    parts.reserve(chunks.size() * 2 + 1);
+    parts.push_back(open);
+    for (std::size_t i = 0; i < chunks.size(); ++i) {
+        if (i > 0) parts.push_back(separator);
+        parts.push_back(chunks[i]->json(fields));
+    }
+    parts.push_back(close);
+    return parts;
+}
+
+std::string CatalogSnapshot::pageResponse(int after_id, std::size_t limit, bool stale, FieldMask fields) const {
+    auto begin = std::upper_bound(entries.begin(), entries.end(), after_id,
+        [](int id, const std::shared_ptr<const CatalogEntry>& entry) { return id < entry->mod.id; });
+    auto end = begin + static_cast<std::ptrdiff_t>(
+        std::min<std::size_t>(limit, static_cast<std::size_t>(entries.end() - begin)));
+
+    std::string response = "{\"mods\":[";
+    for (auto it = begin; it != end; ++it) {
+        if (it != begin) response += ',';
+        append_mod(response, **it, fields);
+    }
+    finish_page(response, end != begin ? (end - 1)->get() : nullptr, end != entries.end(), stale);
+    return response;
+}
+
+std::string CatalogSnapshot::categoryPageResponse(const std::string& category, int after_id, std::size_t limit,
+                                                  bool stale, FieldMask fields) const {
+    static const std::vector<std::uint32_t> EMPTY;
+    auto found = categories->mods.find(category);
+    const auto& positions = found != categories->mods.end() ? found->second : EMPTY;
+
+    auto begin = std::upper_bound(positions.begin(), positions.end(), after_id,
+        [this](int id, std::uint32_t position) { return id < entries[position]->mod.id; });
+    auto end = begin + static_cast<std::ptrdiff_t>(
+        std::min<std::size_t>(limit, static_cast<std::size_t>(positions.end() - begin)));
+
+    std::string response = "{\"mods\":[";
+    for (auto it = begin; it != end; ++it) {
+        if (it != begin) response += ',';
+        append_mod(response, *entries[*it], fields);
+    }
+    finish_page(response, end != begin ? entries[*(end - 1)].get() : nullptr, end != positions.end(), stale);
+    return response;
+}
+
+std::string CatalogSnapshot::categoriesResponse(bool stale) const {
+    std::string response = "{\"categories\":" + categories->json;
+    if (stale) {
+        response += ",\"stale\":true";
+    }
+    response += "}\n";
+    return response;
+}
+
+std::string CatalogSnapshot::searchResponse(const std::string& query, std::size_t limit, bool stale,
+                                            FieldMask fields) const {
+    auto result = search->search(query, limit);
+
+    std::string response = "{\"mods\":[";
+    for (std::size_t i = 0; i < result.hits.size(); ++i) {
+        if (i > 0) response += ',';
+        append_mod(response, *entries[result.hits[i].document], fields);
+    }
+    response += "],\"total\":" + std::to_string(result.total);
+    if (stale) {
+        response += ",\"stale\":true";
+    }
+    response += "}\n";
+    return response;
+}
+
+std::shared_ptr<const CatalogSnapshot> Catalog::current() const {
+    return std::atomic_load(&snapshot_);
+}
+
+std::shared_ptr<const CatalogEntry> Catalog::makeEntry(ModData mod) {
+    auto entry = std::make_shared<CatalogEntry>();
+    entry->json = mod_to_json(mod).dump();
+    entry->mod = std::move(mod);
+    return entry;
+}
+
+CatalogIndexes Catalog::buildIndexes(const std::vector<std::shared_ptr<const CatalogEntry>>& entries) {
+    return {build_category_index(entries), build_search_index(entries)};
+}
+
+std::shared_ptr<const CatalogSnapshot> Catalog::build(std::vector<std::shared_ptr<const CatalogEntry>> entries,
+                                                      std::vector<std::shared_ptr<const CatalogChunk>> chunks,
+                                                      CatalogIndexes indexes) {
+    auto snapshot = std::make_shared<CatalogSnapshot>();
+    snapshot->loaded_at = std::chrono::system_clock::now();
+
+    // Скобки массива, перевод строки и запятые между кусками
+    std::size_t bytes = 3 + (chunks.empty() ? 0 : chunks.size() - 1);
+    for (const auto& chunk : chunks) {
+        bytes += chunk->json(DEFAULT_FIELDS)->size();
+    }
+
+    snapshot->categories = std::move(indexes.categories);
+    snapshot->search = std::move(indexes.search);
+    snapshot->entries = std::move(entries);
+    snapshot->chunks = std::move(chunks);
+    snapshot->all_mods_bytes = bytes;
+    snapshot->version = ++last_version_;
+
+    std::atomic_store(&snapshot_, std::shared_ptr<const CatalogSnapshot>(snapshot));
+    return snapshot;
+}
+
+std::shared_ptr<const CatalogSnapshot> Catalog::publish(std::vector<std::shared_ptr<const CatalogEntry>> entries) {
+    if (!std::is_sorted(entries.begin(), entries.end(), entry_less)) {
+        std::sort(entries.begin(), entries.end(), entry_less);
+    }
+
+    // Индексы и ответ строятся до захвата мьютекса: полная загрузка не держит его на время сборки
+    auto indexes = buildIndexes(entries);
+    std::vector<std::shared_ptr<const CatalogChunk>> chunks;
+    append_chunks(chunks, entries, 0, entries.size());
+    std::lock_guard<std::mutex> lock(publish_mutex_);
+    pending_counters_.clear();
+    ++counters_version_;
+    auto snapshot = build(std::move(entries), std::move(chunks), std::move(indexes));
+    log_message("Catalog snapshot v" + std::to_string(snapshot->version) + " published: " +
+                std::to_string(snapshot->entries.size()) + " mods, " +
+                std::to_string(snapshot->all_mods_bytes) + " bytes", "INFO");
+    return snapshot;
+}
+
+std::shared_ptr<const CatalogSnapshot> Catalog::apply(ModChanges changes) {
+    if (changes.updated.empty() && changes.deleted.empty()) {
+        std::lock_guard<std::mutex> lock(publish_mutex_);
+        if (pending_counters_.empty()) {
+            return current();
+        }
+    }
+
+    // Сериализация изменённых модов, слияние записей, сборка затронутых кусков ответа
+    // и перестройка индексов идут без publish_mutex_, чтобы не задерживать другие публикации
+    std::vector<std::shared_ptr<const CatalogEntry>> updated;
+    updated.reserve(changes.updated.size());
+    for (auto& mod : changes.updated) {
+        updated.push_back(makeEntry(std::move(mod)));
+    }
+    std::sort(updated.begin(), updated.end(), entry_less);
+    std::unordered_set<int> replaced(changes.deleted.begin(), changes.deleted.end());
+    for (const auto& entry : updated) {
+        replaced.insert(entry->mod.id);
+    }
+
+    std::shared_ptr<const CatalogSnapshot> indexed_base;
+    CatalogIndexes indexes;
+    while (true) {
+        auto base = current();
+        if (!base) {
+            return nullptr;
+        }
+        std::vector<ModCounterDelta> counters;
+        std::uint64_t counters_version;
+        {
+            std::lock_guard<std::mutex> lock(publish_mutex_);
+            counters.reserve(pending_counters_.size());
+            for (const auto& pending : pending_counters_) {
+                counters.push_back(pending.second);
+            }
+            counters_version = counters_version_;
+        }
+
+        // Отложенные счётчики накладываются на остальные моды снимка. Изменённые и удалённые
+        // моды пришли из БД уже с сохранёнными приращениями, им счётчики не добавляем
+        auto patched = updated;
+        for (const auto& delta : counters) {
+            if (replaced.count(delta.mod_id)) {
+                continue;
+            }
+            const ModData* old = base->find(delta.mod_id);
+            if (!old) {
+                continue;
+            }
+            ModData mod = *old;
+            mod.downloads += delta.downloads;
+            mod.views += delta.views;
+            patched.push_back(makeEntry(std::move(mod)));
+        }
+        std::sort(patched.begin(), patched.end(), entry_less);
+
+        auto entries = merge_changes(*base, patched, changes.deleted);
+        auto chunks = patch_chunks(*base, entries, changed_ids(patched, changes.deleted));
+        // Индексы, построенные для другого состава модов, к base не подходят.
+        // Счётчики в индексы не входят, поэтому решение принимается только по изменениям
+        if (!indexed_base || indexed_base->search != base->search) {
+            if (same_indexed_mods(*base, updated, changes.deleted)) {
+                indexes = {base->categories, base->search};
+            } else {
+                indexes = buildIndexes(entries);
+            }
+            indexed_base = base;
+        }
+
+        std::lock_guard<std::mutex> lock(publish_mutex_);
+        // Пока всё это строилось, мог выйти другой снимок или прийти новые счётчики:
+        // накладываем заново. Индексы при этом перестраиваются, только если у снимка другой состав модов
+        if (current() != base || counters_version_ != counters_version) {
+            continue;
+        }
+        pending_counters_.clear();
+        ++counters_version_;
+        auto snapshot = build(std::move(entries), std::move(chunks), indexes);
+        log_message("Catalog snapshot v" + std::to_string(snapshot->version) + " patched: " +
+                    std::to_string(updated.size()) + " updated, " +
+                    std::to_string(changes.deleted.size()) + " deleted, counters of " +
+                    std::to_string(patched.size() - updated.size()) + " mods",
+                    updated.empty() && changes.deleted.empty() ? "DEBUG" : "INFO");
+        return snapshot;
+    }
+}
+
+void Catalog::addCounters(const std::vector<ModCounterDelta>& deltas) {
+    if (deltas.empty()) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(publish_mutex_);
+    for (const auto& delta : deltas) {
+        auto& pending = pending_counters_[delta.mod_id];
+        pending.mod_id = delta.mod_id;
+        pending.downloads += delta.downloads;
+        pending.views += delta.views;
+    }
+    ++counters_version_;
+}
@@ -0,0 +1,140 @@
+#ifndef CATALOG_H
+#define CATALOG_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include "mod_storage.h"
+#include "mod_json.h"
+#include "search_index.h"
+
+// Мод в снимке вместе с его готовым JSON-представлением
+struct CatalogEntry {
+    ModData mod;
+    std::string json;
+};
+
+// Ответ из нескольких готовых кусков; отправляется одной записью со сбором буферов
+using ResponseParts = std::vector<std::shared_ptr<const std::string>>;
+
+// Кусок ответа GET_ALL_MODS: JSON подряд идущих модов снимка через запятую, без скобок.
+// Соседние версии снимка делят куски, где ничего не менялось, поэтому наложение изменений
+// пересобирает только затронутые куски, а не весь ответ
+class CatalogChunk {
+public:
+    CatalogChunk(std::vector<std::shared_ptr<const CatalogEntry>>::const_iterator first, std::size_t count);
+
+    std::size_t mods() const { return entries_.size(); }
+    int lastId() const { return entries_.back()->mod.id; }
+    // JSON с полями по умолчанию готов сразу, остальные маски сериализуются по первому запросу
+    // и дальше живут вместе с куском, в том числе в следующих версиях снимка
+    std::shared_ptr<const std::string> json(FieldMask fields) const;
+
+private:
+    std::vector<std::shared_ptr<const CatalogEntry>> entries_;
+    std::shared_ptr<const std::string> json_;
+    mutable std::mutex projections_mutex_;
+    mutable std::unordered_map<FieldMask, std::shared_ptr<const std::string>> projections_;
+};
+
+// Индекс категорий снимка. Позиции модов в entries идут по возрастанию, то есть и по id
+struct CategoryIndex {
+    std::map<std::string, std::vector<std::uint32_t>> mods;
+    // JSON-массив [{"name":...,"count":...}] для GET_CATEGORIES, по алфавиту
+    std::string json;
+};
+
+// Индексы снимка. Строятся по entries и общие у снимков, которые различаются только
+// полями вне индексов (счётчики, ссылки, медиа)
+struct CatalogIndexes {
+    std::shared_ptr<const CategoryIndex> categories;
+    std::shared_ptr<const SearchIndex> search;
+};
+
+// Неизменяемый снимок каталога. После публикации не меняется,
+// поэтому читатели работают с ним без блокировок.
+struct CatalogSnapshot {
+    std::uint64_t version = 0;
+    std::chrono::system_clock::time_point loaded_at;
+    // Моды, отсортированные по id. Записи общие у соседних версий снимка
+    std::vector<std::shared_ptr<const CatalogEntry>> entries;
+    // Ответ на GET_ALL_MODS по кускам, в порядке entries
+    std::vector<std::shared_ptr<const CatalogChunk>> chunks;
+    // Размер ответа GET_ALL_MODS с полями по умолчанию (JSON-массив с переводом строки в конце)
+    std::size_t all_mods_bytes = 0;
+    // Общий у соседних версий, пока состав модов и их категории не меняются
+    std::shared_ptr<const CategoryIndex> categories;
+    // Поиск по названию и описанию; документы - позиции в entries. Общий так же, как categories
+    std::shared_ptr<const SearchIndex> search;
+
+    const ModData* find(int mod_id) const;
+    std::shared_ptr<const CatalogEntry> entry(int mod_id) const;
+
+    // Ответ на GET_ALL_MODS с выбранными полями: скобки массива и куски через запятую
+    ResponseParts allModsResponse(FieldMask fields) const;
+
+    // Ответ на GET_MODS_PAGE (keyset-пагинация): до limit модов с id > after_id и курсор
+    // следующей страницы ({"mods":[...],"next_cursor":id или null}) с переводом строки в конце.
+    // stale добавляет пометку "stale":true, когда снимок может быть устаревшим
+    std::string pageResponse(int after_id, std::size_t limit, bool stale = false,
+                             FieldMask fields = DEFAULT_FIELDS) const;
+    // То же для модов одной категории; неизвестная категория даёт пустую страницу.
+    // Работа пропорциональна размеру страницы, а не каталога
+    std::string categoryPageResponse(const std::string& category, int after_id, std::size_t limit,
+                                     bool stale = false, FieldMask fields = DEFAULT_FIELDS) const;
+    // Ответ на GET_CATEGORIES: {"categories":[...]} с переводом строки в конце
+    std::string categoriesResponse(bool stale = false) const;
+    // Ответ на SEARCH: до limit лучших по BM25 модов и общее число совпадений
+    // ({"mods":[...],"total":N}) с переводом строки в конце
+    std::string searchResponse(const std::string& query, std::size_t limit, bool stale = false,
+                               FieldMask fields = DEFAULT_FIELDS) const;
+};
+
+// Держит текущий снимок и атомарно подменяет его при обновлении (RCU):
+// старый снимок живёт, пока его держит хотя бы один читатель.
+class Catalog {
+public:
+    std::shared_ptr<const CatalogSnapshot> current() const;
+
+    // Готовит запись снимка: сериализует мод один раз. Вызывается по мере чтения строк из БД
+    static std::shared_ptr<const CatalogEntry> makeEntry(ModData mod);
+
+    // Строит новый снимок из полностью загруженного каталога и публикует его
+    std::shared_ptr<const CatalogSnapshot> publish(std::vector<std::shared_ptr<const CatalogEntry>> entries);
+
+    // Накладывает изменения на текущий снимок: неизменённые записи и куски ответа GET_ALL_MODS
+    // переиспользуются, сериализуются только новые и изменённые моды. Индексы переиспользуются,
+    // если изменения их не затрагивают. Всё строится вне publish_mutex_, под ним - только подмена
+    // снимка. Без текущего снимка возвращает nullptr
+    std::shared_ptr<const CatalogSnapshot> apply(ModChanges changes);
+    // Запоминает сохранённые в БД приращения счётчиков. Снимок их получает при следующем apply()
+    // (инкрементальное обновление или запись), а не на каждый сброс: иначе каталог
+    // пересобирался бы раз в несколько секунд. publish() их отбрасывает - полная загрузка
+    // читает счётчики из БД; приращения, сохранённые во время неё, придут со следующей
+    void addCounters(const std::vector<ModCounterDelta>& deltas);
+
+private:
+    // Тяжёлая часть публикации; вызывается без publish_mutex_
+    static CatalogIndexes buildIndexes(const std::vector<std::shared_ptr<const CatalogEntry>>& entries);
+    // Вызывать под publish_mutex_
+    std::shared_ptr<const CatalogSnapshot> build(std::vector<std::shared_ptr<const CatalogEntry>> entries,
+                                                 std::vector<std::shared_ptr<const CatalogChunk>> chunks,
+                                                 CatalogIndexes indexes);
+
+    std::shared_ptr<const CatalogSnapshot> snapshot_;
+    std::atomic<std::uint64_t> last_version_{0};
+    // Сериализует писателей; читатели его не берут
+    std::mutex publish_mutex_;
+    // Приращения счётчиков, ещё не наложенные на снимок; под publish_mutex_
+    std::unordered_map<int, ModCounterDelta> pending_counters_;
+    // Меняется при каждом изменении pending_counters_; под publish_mutex_
+    std::uint64_t counters_version_ = 0;
+};
+
+#endif // CATALOG_H
@@ -0,0 +1,281 @@
+#include "catalog_file.h"
+#include "logger.h"
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+constexpr char MAGIC[8] = {'M', 'O', 'D', 'C', 'A', 'T', '\0', '\0'};
+// Меняется при любом изменении раскладки данных
+constexpr std::uint32_t FORMAT_VERSION = 1;
+
+struct FileHeader {
+    char magic[8];
+    std::uint32_t format_version;
+    // Маска полей, с которой сериализован сохранённый JSON; при несовпадении JSON строится заново
+    std::uint32_t json_fields;
+    std::uint64_t mod_count;
+    std::uint64_t payload_size;
+    std::uint64_t checksum;
+};
+
+constexpr std::uint64_t FNV_OFFSET = 14695981039346656037ull;
+constexpr std::uint64_t FNV_PRIME = 1099511628211ull;
+
+std::uint64_t fnv1a(std::uint64_t hash, const char* data, std::size_t size) {
+    for (std::size_t i = 0; i < size; ++i) {
+        hash ^= static_cast<unsigned char>(data[i]);
+        hash *= FNV_PRIME;
+    }
+    return hash;
+}
+
+// Потоковая запись данных с подсчётом контрольной суммы
+class PayloadWriter {
+public:
+    explicit PayloadWriter(std::FILE* file) : file_(file) {}
+
+    template <typename T>
+    void put(T value) { write(reinterpret_cast<const char*>(&value), sizeof(value)); }
+
+    void putString(const std::string& value) {
+        put(static_cast<std::uint32_t>(value.size()));
+        write(value.data(), value.size());
+    }
+
+    bool ok() const { return ok_; }
+    std::uint64_t size() const { return size_; }
+    std::uint64_t checksum() const { return checksum_; }
+
+private:
+    void write(const char* data, std::size_t size) {
+        if (!ok_ || size == 0) return;
+        ok_ = std::fwrite(data, 1, size, file_) == size;
+        checksum_ = fnv1a(checksum_, data, size);
+        size_ += size;
+    }
+
+    std::FILE* file_;
+    bool ok_ = true;
+    std::uint64_t size_ = 0;
+    std::uint64_t checksum_ = FNV_OFFSET;
+};
+
+// Чтение данных из отображённого файла с проверкой границ
+class PayloadReader {
+public:
+    PayloadReader(const char* data, std::size_t size) : data_(data), end_(data + size) {}
+
+    template <typename T>
+    bool get(T& value) {
+        if (static_cast<std::size_t>(end_ - data_) < sizeof(T)) return false;
+        std::memcpy(&value, data_, sizeof(T));
+        data_ += sizeof(T);
+        return true;
+    }
+
+    bool getString(std::string& value) {
+        std::uint32_t size = 0;
+        if (!get(size) || static_cast<std::size_t>(end_ - data_) < size) return false;
+        value.assign(data_, size);
+        data_ += size;
+        return true;
+    }
+
+    bool atEnd() const { return data_ == end_; }
+
+private:
+    const char* data_;
+    const char* end_;
+};
+
+// Файл, отображённый в память только для чтения. Без mmap (Windows) читается целиком
+class MappedFile {
+public:
+    explicit MappedFile(const std::string& path) {
+#ifndef _WIN32
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) return;
+        struct stat st {};
+        if (::fstat(fd, &st) == 0 && st.st_size > 0) {
+            void* mapped = ::mmap(nullptr, static_cast<std::size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+            if (mapped != MAP_FAILED) {
+                // Файл читается один раз от начала до конца
+                ::madvise(mapped, static_cast<std::size_t>(st.st_size), MADV_SEQUENTIAL);
+                data_ = static_cast<const char*>(mapped);
+                size_ = static_cast<std::size_t>(st.st_size);
+            }
+        }
+        ::close(fd);
+#else
+        std::ifstream file(path, std::ios::binary);
+        if (!file) return;
+        buffer_.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+        data_ = buffer_.data();
+        size_ = buffer_.size();
+#endif
+    }
+
+    ~MappedFile() {
+#ifndef _WIN32
+        if (data_) {
+            ::munmap(const_cast<char*>(data_), size_);
+        }
+#endif
+    }
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    const char* data() const { return data_; }
+    std::size_t size() const { return size_; }
+
+private:
+    const char* data_ = nullptr;
+    std::size_t size_ = 0;
+#ifdef _WIN32
+    std::string buffer_;
+#endif
+};
+
+} // namespace
+
+bool save_catalog_file(const CatalogSnapshot& snapshot, const std::string& path) {
+    auto started = std::chrono::steady_clock::now();
+    std::string temp_path = path + ".tmp";
+    std::FILE* file = std::fopen(temp_path.c_str(), "wb");
+    if (!file) {
+        log_message("Cannot create catalog file " + temp_path, "ERROR");
+        return false;
+    }
+
+    // Заголовок пишется последним, когда известны размер и контрольная сумма данных
+    FileHeader header{};
+    std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.format_version = FORMAT_VERSION;
+    header.json_fields = DEFAULT_FIELDS;
+    header.mod_count = snapshot.entries.size();
+    bool ok = std::fwrite(&header, sizeof(header), 1, file) == 1;
+
+    PayloadWriter writer(file);
+    for (const auto& entry : snapshot.entries) {
+        const ModData& mod = entry->mod;
+        writer.put(static_cast<std::int32_t>(mod.id));
+        writer.put(static_cast<std::uint64_t>(mod.downloads));
+        writer.put(static_cast<std::uint64_t>(mod.views));
+        writer.putString(mod.name);
+        writer.putString(mod.description);
+        writer.putString(mod.link);
+        writer.putString(mod.category);
+        writer.put(static_cast<std::uint32_t>(mod.media_links.size()));
+        for (const auto& media : mod.media_links) {
+            writer.putString(media);
+        }
+        writer.putString(entry->json);
+    }
+
+    header.payload_size = writer.size();
+    header.checksum = writer.checksum();
+    ok = ok && writer.ok() && std::fseek(file, 0, SEEK_SET) == 0 &&
+         std::fwrite(&header, sizeof(header), 1, file) == 1 && std::fflush(file) == 0;
+#ifndef _WIN32
+    // Иначе после сбоя питания на месте файла может оказаться пустой
+    ok = ok && ::fsync(::fileno(file)) == 0;
+#endif
+    ok = std::fclose(file) == 0 && ok;
+
+    if (ok) {
+#ifdef _WIN32
+        std::remove(path.c_str());
+#endif
+        ok = std::rename(temp_path.c_str(), path.c_str()) == 0;
+    }
+    if (!ok) {
+        log_message("Failed to write catalog file " + path, "ERROR");
+        std::remove(temp_path.c_str());
+        return false;
+    }
+
+    auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - started);
+    log_message("Catalog snapshot v" + std::to_string(snapshot.version) + " saved to " + path + ": " +
+                std::to_string(snapshot.entries.size()) + " mods, " +
+                std::to_string(sizeof(header) + header.payload_size) + " bytes in " +
+                std::to_string(elapsed.count()) + " ms", "INFO");
+    return true;
+}
+
+std::optional<std::vector<std::shared_ptr<const CatalogEntry>>> load_catalog_file(const std::string& path) {
+    auto started = std::chrono::steady_clock::now();
+    MappedFile file(path);
+    if (!file.data()) {
+        log_message("Catalog file " + path + " not found", "INFO");
+        return std::nullopt;
+    }
+
+    FileHeader header{};
+    if (file.size() < sizeof(header)) {
+        log_message("Catalog file " + path + " is truncated", "WARNING");
+        return std::nullopt;
+    }
+    std::memcpy(&header, file.data(), sizeof(header));
+    if (std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0 || header.format_version != FORMAT_VERSION) {
+        log_message("Catalog file " + path + " has unsupported format, ignoring it", "WARNING");
+        return std::nullopt;
+    }
+
+    const char* payload = file.data() + sizeof(header);
+    if (header.payload_size != file.size() - sizeof(header) ||
+        fnv1a(FNV_OFFSET, payload, static_cast<std::size_t>(header.payload_size)) != header.checksum) {
+        log_message("Catalog file " + path + " is corrupted (checksum mismatch), ignoring it", "WARNING");
+        return std::nullopt;
+    }
+
+    // JSON, сохранённый с другим набором полей по умолчанию, строим заново
+    bool reuse_json = header.json_fields == DEFAULT_FIELDS;
+    PayloadReader reader(payload, static_cast<std::size_t>(header.payload_size));
+    std::vector<std::shared_ptr<const CatalogEntry>> entries;
+    entries.reserve(static_cast<std::size_t>(header.mod_count));
+    for (std::uint64_t i = 0; i < header.mod_count; ++i) {
+        auto entry = std::make_shared<CatalogEntry>();
+        ModData& mod = entry->mod;
+        std::int32_t id = 0;
+        std::uint32_t media_count = 0;
+        bool ok = reader.get(id) && reader.get(mod.downloads) && reader.get(mod.views) &&
+                  reader.getString(mod.name) && reader.getString(mod.description) &&
+                  reader.getString(mod.link) && reader.getString(mod.category) && reader.get(media_count);
+        for (std::uint32_t m = 0; ok && m < media_count; ++m) {
+            mod.media_links.emplace_back();
+            ok = reader.getString(mod.media_links.back());
+        }
+        ok = ok && reader.getString(entry->json);
+        if (!ok) {
+            log_message("Catalog file " + path + " is malformed at mod #" + std::to_string(i), "WARNING");
+            return std::nullopt;
+        }
+        mod.id = id;
+        if (!reuse_json) {
+            entry->json = mod_to_json(mod).dump();
+        }
+        entries.push_back(std::move(entry));
+    }
+    if (!reader.atEnd()) {
+        log_message("Catalog file " + path + " has trailing data, ignoring it", "WARNING");
+        return std::nullopt;
+    }
+
+    auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - started);
+    log_message("Catalog file " + path + " loaded: " + std::to_string(entries.size()) + " mods in " +
+                std::to_string(elapsed.count()) + " ms", "INFO");
+    return entries;
+}
@@ -0,0 +1,22 @@
+#ifndef CATALOG_FILE_H
+#define CATALOG_FILE_H
+
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+#include "catalog.h"
+
+// Бинарный файл снимка каталога для старта без MySQL.
+// Заголовок: сигнатура, версия формата, маска полей сохранённого JSON, число модов,
+// размер данных и их контрольная сумма (FNV-1a 64). Данные: для каждого мода id, счётчики,
+// строки полей, медиа и готовый JSON записи, так что при загрузке ничего не сериализуется.
+// Числа пишутся в порядке байт машины: файл переносим только между одинаковыми платформами.
+
+// Записывает снимок во временный файл рядом с path и атомарно подменяет им path
+bool save_catalog_file(const CatalogSnapshot& snapshot, const std::string& path);
+
+// Читает файл через mmap. nullopt - файла нет, он повреждён или другой версии формата
+std::optional<std::vector<std::shared_ptr<const CatalogEntry>>> load_catalog_file(const std::string& path);
+
+#endif // CATALOG_FILE_H
@@ -0,0 +1,83 @@
+#include "circuit_breaker.h"
+#include "logger.h"
+
+CircuitBreaker::CircuitBreaker(const CircuitBreakerOptions& options)
+    : options_(options) {
+    if (options_.failure_threshold < 1) {
+        options_.failure_threshold = 1;
+    }
+    if (options_.half_open_probes < 1) {
+        options_.half_open_probes = 1;
+    }
+}
+
+bool CircuitBreaker::allow() {
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    if (state_ == State::Open) {
+        if (std::chrono::steady_clock::now() < open_until_) {
+            return false;
+        }
+        transition(State::HalfOpen);
+    }
+
+    if (state_ == State::HalfOpen) {
+        if (probes_in_flight_ >= options_.half_open_probes) {
+            return false;
+        }
+        ++probes_in_flight_;
+    }
+    return true;
+}
+
+void CircuitBreaker::recordSuccess() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    failures_ = 0;
+    if (state_ != State::Closed) {
+        transition(State::Closed);
+    }
+}
+
+void CircuitBreaker::recordFailure() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    ++failures_;
+    if (state_ == State::HalfOpen || (state_ == State::Closed && failures_ >= options_.failure_threshold)) {
+        transition(State::Open);
+    }
+}
+
+void CircuitBreaker::cancel() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    // В замкнутом состоянии allow() пробы не занимает, отпускать нечего
+    if (state_ == State::HalfOpen && probes_in_flight_ > 0) {
+        --probes_in_flight_;
+    }
+}
+
+CircuitBreaker::State CircuitBreaker::state() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return state_;
+}
+
+std::string CircuitBreaker::stateName(State state) {
+    switch (state) {
+        case State::Closed: return "closed";
+        case State::Open: return "open";
+        case State::HalfOpen: return "half-open";
+    }
+    return "unknown";
+}
+
+void CircuitBreaker::transition(State next) {
+    if (next == State::Open) {
+        open_until_ = std::chrono::steady_clock::now() + options_.open_duration;
+    }
+    probes_in_flight_ = 0;
+    if (next == State::Closed) {
+        failures_ = 0;
+    }
+
+    log_message("Database circuit breaker: " + stateName(state_) + " -> " + stateName(next),
+                next == State::Open ? "WARNING" : "INFO");
+    state_ = next;
+}
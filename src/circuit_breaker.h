@@ -0,0 +1,49 @@
+#ifndef CIRCUIT_BREAKER_H
+#define CIRCUIT_BREAKER_H
+
+#include <chrono>
+#include <mutex>
+#include <string>
+
+struct CircuitBreakerOptions {
+    // Сколько ошибок подряд размыкают цепь
+    int failure_threshold = 5;
+    // Сколько цепь остаётся разомкнутой, прежде чем пропустить пробный запрос
+    std::chrono::milliseconds open_duration{10000};
+    // Сколько пробных запросов одновременно пропускается в полуоткрытом состоянии
+    int half_open_probes = 1;
+};
+
+// Автомат защиты для обращений к БД. Пока цепь разомкнута, запросы к MySQL
+// не выполняются вовсе и вызывающий сразу переходит к запасному варианту,
+// вместо того чтобы каждый раз ждать таймаутов подключения и чтения.
+class CircuitBreaker {
+public:
+    enum class State { Closed, Open, HalfOpen };
+
+    explicit CircuitBreaker(const CircuitBreakerOptions& options);
+
+    // Можно ли сейчас обращаться к БД. В полуоткрытом состоянии разрешает
+    // только пробные запросы; их результат нужно сообщить через record*
+    bool allow();
+    void recordSuccess();
+    void recordFailure();
+    // Отпускает пробу без вердикта: после allow() запрос так и не дошёл до БД
+    // (очередь переполнена или он присоединился к уже идущей загрузке)
+    void cancel();
+
+    State state() const;
+    static std::string stateName(State state);
+
+private:
+    void transition(State next);
+
+    CircuitBreakerOptions options_;
+    mutable std::mutex mutex_;
+    State state_ = State::Closed;
+    int failures_ = 0;
+    int probes_in_flight_ = 0;
+    std::chrono::steady_clock::time_point open_until_;
+};
+
+#endif // CIRCUIT_BREAKER_H
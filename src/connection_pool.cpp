@@ -0,0 +1,352 @@
+#include "connection_pool.h"
+#include "logger.h"
+#include "query_stats.h"
+#include <algorithm>
+#include <utility>
+
+ConnectionPool::Handle::Handle(ConnectionPool* pool, PooledConnection* conn)
+    : pool_(pool), conn_(conn) {
+}
+
+ConnectionPool::Handle::Handle(Handle&& other) noexcept
+    : pool_(other.pool_), conn_(other.conn_) {
+    other.pool_ = nullptr;
+    other.conn_ = nullptr;
+}
+
+ConnectionPool::Handle& ConnectionPool::Handle::operator=(Handle&& other) noexcept {
+    if (this != &other) {
+        release();
+        pool_ = std::exchange(other.pool_, nullptr);
+        conn_ = std::exchange(other.conn_, nullptr);
+    }
+    return *this;
+}
+
+ConnectionPool::Handle::~Handle() {
+    release();
+}
+
+MYSQL_STMT* ConnectionPool::Handle::prepare(const std::string& sql) {
+    if (!conn_) return nullptr;
+    return prepareStatement(*conn_, sql);
+}
+
+void ConnectionPool::Handle::discardStatement(const std::string& sql) {
+    if (!conn_) return;
+
+    auto it = conn_->statements.find(sql);
+    if (it != conn_->statements.end()) {
+        mysql_stmt_close(it->second);
+        conn_->statements.erase(it);
+    }
+}
+
+void ConnectionPool::Handle::markBroken() {
+    if (conn_) {
+        conn_->health = ConnectionHealth::Broken;
+    }
+}
+
+void ConnectionPool::Handle::release() {
+    if (pool_ && conn_) {
+        pool_->giveBack(conn_);
+    }
+    pool_ = nullptr;
+    conn_ = nullptr;
+}
+
+ConnectionPool::ConnectionPool(PoolOptions options)
+    : options_(std::move(options)) {
+    if (options_.max_size == 0) {
+        options_.max_size = 1;
+    }
+    options_.min_size = std::min(options_.min_size, options_.max_size);
+    opener_ = std::thread([this]() { openerLoop(); });
+}
+
+ConnectionPool::~ConnectionPool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    demand_.notify_all();
+    opener_.join();
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (auto& conn : connections_) {
+        closeConnection(*conn);
+    }
+}
+
+void ConnectionPool::closeConnection(PooledConnection& conn) {
+    for (auto& entry : conn.statements) {
+        mysql_stmt_close(entry.second);
+    }
+    conn.statements.clear();
+
+    if (conn.mysql) {
+        mysql_close(conn.mysql);
+        conn.mysql = nullptr;
+    }
+}
+
+MYSQL_STMT* ConnectionPool::prepareStatement(PooledConnection& conn, const std::string& sql) {
+    auto it = conn.statements.find(sql);
+    if (it != conn.statements.end()) {
+        return it->second;
+    }
+
+    MYSQL_STMT* stmt = mysql_stmt_init(conn.mysql);
+    if (!stmt) {
+        log_message("Error initializing statement: " + std::string(mysql_error(conn.mysql)), "ERROR");
+        return nullptr;
+    }
+    if (mysql_stmt_prepare(stmt, sql.c_str(), static_cast<unsigned long>(sql.size()))) {
+        log_message("Error preparing statement: " + std::string(mysql_stmt_error(stmt)), "ERROR");
+        mysql_stmt_close(stmt);
+        return nullptr;
+    }
+
+    conn.statements.emplace(sql, stmt);
+    return stmt;
+}
+
+MYSQL* ConnectionPool::openConnection() {
+    MYSQL* mysql = mysql_init(nullptr);
+    if (!mysql) {
+        log_message("Error initializing MySQL", "ERROR");
+        return nullptr;
+    }
+
+    // Устанавливаем таймаут подключения
+    int timeout = 5;
+    mysql_options(mysql, MYSQL_OPT_CONNECT_TIMEOUT, &timeout);
+
+    // Автоматическое переподключение не включаем: потерянные соединения
+    // закрываются пулом и заменяются новыми
+
+    // Устанавливаем таймаут чтения
+    int read_timeout = 30;
+    mysql_options(mysql, MYSQL_OPT_READ_TIMEOUT, &read_timeout);
+
+    // Устанавливаем таймаут записи
+    int write_timeout = 30;
+    mysql_options(mysql, MYSQL_OPT_WRITE_TIMEOUT, &write_timeout);
+
+    QueryTimer timer(QueryKind::Connect, "CONNECT");
+    if (!mysql_real_connect(mysql, options_.host.c_str(), options_.user.c_str(),
+                            options_.password.c_str(), options_.db_name.c_str(),
+                            0, nullptr, 0)) {
+        log_message("Failed to connect to database: " +
+                    std::string(mysql_error(mysql)), "ERROR");
+        mysql_close(mysql);
+        return nullptr;
+    }
+    timer.setConnection(mysql_thread_id(mysql));
+    timer.finish(true);
+    return mysql;
+}
+
+bool ConnectionPool::openIdleConnection() {
+    MYSQL* mysql = openConnection();
+    if (!mysql) {
+        return false;
+    }
+
+    auto conn = std::make_unique<PooledConnection>();
+    conn->mysql = mysql;
+    // Готовим запросы горячего пути сейчас, чтобы первый запрос клиента не платил за prepare
+    for (const auto& sql : options_.warm_statements) {
+        prepareStatement(*conn, sql);
+    }
+    conn->last_used = conn->last_ping = std::chrono::steady_clock::now();
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        conn->id = next_id_++;
+        idle_.push_back(conn.get());
+        connections_.push_back(std::move(conn));
+    }
+    available_.notify_all();
+    return true;
+}
+
+bool ConnectionPool::start() {
+    std::size_t opened = 0;
+    for (std::size_t i = 0; i < options_.min_size; ++i) {
+        if (openIdleConnection()) {
+            ++opened;
+        }
+    }
+
+    if (opened == 0 && options_.min_size > 0) {
+        return false;
+    }
+
+    log_message("Connection pool started: " + std::to_string(opened) + " connection(s), max " +
+                std::to_string(options_.max_size), "INFO");
+    return true;
+}
+
+bool ConnectionPool::ping(PooledConnection* conn) {
+    conn->health = ConnectionHealth::Suspect;
+    QueryTimer timer(QueryKind::Ping, "PING", mysql_thread_id(conn->mysql));
+    if (mysql_ping(conn->mysql) != 0) {
+        log_message("Lost connection to MySQL (ping failed) on connection #" +
+                    std::to_string(conn->id) + ", replacing it", "WARNING");
+        conn->health = ConnectionHealth::Broken;
+        return false;
+    }
+    timer.finish(true);
+    conn->health = ConnectionHealth::Healthy;
+    conn->last_ping = std::chrono::steady_clock::now();
+    return true;
+}
+
+void ConnectionPool::maintain() {
+    auto now = std::chrono::steady_clock::now();
+
+    // Давно простаивающие соединения на время проверки убираем из свободных,
+    // чтобы их не получил запрос
+    std::vector<PooledConnection*> to_ping;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto fresh_end = std::stable_partition(idle_.begin(), idle_.end(), [&](PooledConnection* conn) {
+            return now - std::max(conn->last_used, conn->last_ping) < options_.keepalive_interval;
+        });
+        to_ping.assign(fresh_end, idle_.end());
+        idle_.erase(fresh_end, idle_.end());
+    }
+
+    for (PooledConnection* conn : to_ping) {
+        ping(conn);
+        giveBack(conn);
+    }
+
+    // Восполняем пул до min_size заранее, а не на пути запроса
+    std::size_t opened = 0;
+    while (true) {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (connections_.size() + opening_ >= options_.min_size) {
+                break;
+            }
+            ++opening_;
+        }
+        bool ok = openIdleConnection();
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            --opening_;
+        }
+        if (!ok) {
+            break;
+        }
+        ++opened;
+    }
+    if (opened > 0) {
+        log_message("Connection pool pre-warmed " + std::to_string(opened) + " connection(s)", "INFO");
+    }
+}
+
+void ConnectionPool::openerLoop() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (true) {
+        demand_.wait(lock, [this]() {
+            return stopping_ || (waiting_ > idle_.size() + opening_ &&
+                                 connections_.size() + opening_ < options_.max_size);
+        });
+        if (stopping_) {
+            return;
+        }
+
+        ++opening_;
+        lock.unlock();
+        bool ok = openIdleConnection();
+        lock.lock();
+        --opening_;
+        if (!ok) {
+            // Сервер недоступен: ждущие запросы сразу получают ошибку, а не ждут таймаута
+            ++failed_opens_;
+        }
+        available_.notify_all();
+    }
+}
+
+ConnectionPool::Handle ConnectionPool::acquire() {
+    auto handles = acquire(1);
+    return handles.empty() ? Handle() : std::move(handles.front());
+}
+
+std::vector<ConnectionPool::Handle> ConnectionPool::acquire(std::size_t count) {
+    std::vector<Handle> handles;
+    if (count > options_.max_size) {
+        log_message("Cannot take " + std::to_string(count) + " connections from a pool of max " +
+                    std::to_string(options_.max_size), "ERROR");
+        return handles;
+    }
+
+    auto deadline = std::chrono::steady_clock::now() + options_.checkout_timeout;
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (idle_.size() < count) {
+        waiting_ += count;
+        demand_.notify_one();
+        std::uint64_t failed_opens = failed_opens_;
+        bool ready = available_.wait_until(lock, deadline, [this, count, failed_opens]() {
+            return idle_.size() >= count || failed_opens_ != failed_opens;
+        });
+        waiting_ -= count;
+        if (idle_.size() < count) {
+            if (!ready) {
+                log_message("Timed out waiting for a database connection (pool size " +
+                            std::to_string(connections_.size()) + ")", "ERROR");
+            }
+            return handles;
+        }
+    }
+
+    handles.reserve(count);
+    for (std::size_t i = 0; i < count; ++i) {
+        PooledConnection* conn = idle_.back();
+        idle_.pop_back();
+        ++conn->use_count;
+        handles.emplace_back(this, conn);
+    }
+    return handles;
+}
+
+void ConnectionPool::giveBack(PooledConnection* conn) {
+    std::unique_ptr<PooledConnection> to_close;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (conn->health == ConnectionHealth::Broken) {
+            auto it = std::find_if(connections_.begin(), connections_.end(),
+                                   [conn](const std::unique_ptr<PooledConnection>& c) { return c.get() == conn; });
+            if (it != connections_.end()) {
+                to_close = std::move(*it);
+                connections_.erase(it);
+            }
+        } else {
+            conn->last_used = std::chrono::steady_clock::now();
+            idle_.push_back(conn);
+        }
+    }
+    // Будим всех: первым проснувшимся может оказаться запрос, которому нужно больше соединений
+    available_.notify_all();
+
+    if (to_close) {
+        // Освободилось место в пуле: ждущим запросам можно открыть замену
+        demand_.notify_one();
+        closeConnection(*to_close);
+    }
+}
+
+std::size_t ConnectionPool::size() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return connections_.size();
+}
+
+std::size_t ConnectionPool::idle() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return idle_.size();
+}
@@ -0,0 +1,136 @@
+#ifndef CONNECTION_POOL_H
+#define CONNECTION_POOL_H
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <thread>
+#include <unordered_map>
+#include <mysql.h>
+
+// Параметры подключения и размеры пула
+struct PoolOptions {
+    std::string host;
+    std::string user;
+    std::string password;
+    std::string db_name;
+    std::size_t min_size = 2;
+    std::size_t max_size = 8;
+    std::chrono::milliseconds checkout_timeout{2000};
+    // Свободное соединение, простоявшее дольше, проверяется фоновым ping
+    std::chrono::seconds keepalive_interval{60};
+    // Запросы, которые заранее готовятся на каждом открытом в фоне соединении
+    std::vector<std::string> warm_statements;
+};
+
+// Состояние отдельного соединения в пуле
+enum class ConnectionHealth {
+    Healthy,   // соединение рабочее
+    Suspect,   // давно не использовалось, сейчас проверяется фоновым ping
+    Broken     // соединение потеряно, будет закрыто при возврате
+};
+
+struct PooledConnection {
+    MYSQL* mysql = nullptr;
+    unsigned id = 0;
+    ConnectionHealth health = ConnectionHealth::Healthy;
+    std::chrono::steady_clock::time_point last_used;
+    std::chrono::steady_clock::time_point last_ping;
+    unsigned long long use_count = 0;
+    // Подготовленные запросы живут вместе с соединением, ключ - текст SQL
+    std::unordered_map<std::string, MYSQL_STMT*> statements;
+};
+
+// Пул соединений с MySQL. Каждый поток берёт собственное соединение
+// на время запроса, поэтому запросы из разных сессий идут параллельно.
+class ConnectionPool {
+public:
+    // RAII-аренда соединения: при уничтожении соединение возвращается в пул
+    class Handle {
+    public:
+        Handle() = default;
+        Handle(ConnectionPool* pool, PooledConnection* conn);
+        Handle(Handle&& other) noexcept;
+        Handle& operator=(Handle&& other) noexcept;
+        Handle(const Handle&) = delete;
+        Handle& operator=(const Handle&) = delete;
+        ~Handle();
+
+        MYSQL* get() const { return conn_ ? conn_->mysql : nullptr; }
+        unsigned id() const { return conn_ ? conn_->id : 0; }
+        explicit operator bool() const { return conn_ != nullptr; }
+
+        // Возвращает подготовленный запрос из кэша соединения, готовя его при первом обращении.
+        // nullptr означает ошибку подготовки (она уже записана в лог)
+        MYSQL_STMT* prepare(const std::string& sql);
+        // Удаляет запрос из кэша, например после ошибки выполнения
+        void discardStatement(const std::string& sql);
+
+        // Помечаем соединение как потерянное: пул закроет его вместо повторного использования
+        void markBroken();
+        void release();
+
+    private:
+        ConnectionPool* pool_ = nullptr;
+        PooledConnection* conn_ = nullptr;
+    };
+
+    explicit ConnectionPool(PoolOptions options);
+    ~ConnectionPool();
+
+    ConnectionPool(const ConnectionPool&) = delete;
+    ConnectionPool& operator=(const ConnectionPool&) = delete;
+
+    // Открывает min_size соединений. Возвращает false, если не удалось открыть ни одного
+    bool start();
+
+    // Выдаёт свободное соединение. Если свободных нет, ждёт до checkout_timeout, пока его вернут
+    // или фоновый поток откроет новое (до max_size); сам запрос соединений не открывает.
+    // По таймауту или если новое соединение открыть не удалось, возвращает пустой Handle.
+    // Соединение не проверяется: это делает maintain(), а обрыв между проверками
+    // обнаруживает сам запрос и повторяет его на новом соединении
+    Handle acquire();
+    // Выдаёт count соединений разом или ни одного. Запрос, которому нужно несколько соединений,
+    // не держит одно, ожидая следующего, поэтому два таких запроса не блокируют друг друга
+    std::vector<Handle> acquire(std::size_t count);
+
+    // Фоновое обслуживание (блокирующее): пингует простаивающие соединения,
+    // закрывает потерянные и заранее открывает недостающие до min_size
+    void maintain();
+
+    std::size_t size() const;
+    std::size_t idle() const;
+    const PoolOptions& options() const { return options_; }
+
+private:
+    MYSQL* openConnection();
+    // Открывает соединение вместе с подготовленными warm_statements и кладёт его в свободные
+    bool openIdleConnection();
+    static void closeConnection(PooledConnection& conn);
+    static MYSQL_STMT* prepareStatement(PooledConnection& conn, const std::string& sql);
+    void giveBack(PooledConnection* conn);
+    bool ping(PooledConnection* conn);
+    // Фоновый поток: открывает соединения, пока ждущих запросов больше, чем свободных
+    void openerLoop();
+
+    PoolOptions options_;
+    mutable std::mutex mutex_;
+    std::condition_variable available_;
+    std::vector<std::unique_ptr<PooledConnection>> connections_;
+    std::vector<PooledConnection*> idle_;
+    std::size_t opening_ = 0; // соединения, которые сейчас открываются вне мьютекса
+    unsigned next_id_ = 1;
+    std::condition_variable demand_;
+    std::size_t waiting_ = 0; // соединения, которых ждут запросы в acquire()
+    std::uint64_t failed_opens_ = 0; // неудачные попытки фонового открытия
+    bool stopping_ = false;
+    // Запускается последним, когда остальные поля уже инициализированы
+    std::thread opener_;
+};
+
+#endif // CONNECTION_POOL_H
@@ -1,210 +1,1070 @@
 #include "database.h"
 #include "logger.h"
+#include "query_stats.h"
+#include <errmsg.h>
+#include <mysqld_error.h>
+#include <algorithm>
 #include <sstream>
 #include <iostream>
 #include <chrono>
-#include <mutex>
+#include <unordered_map>
+#include <unordered_set>
 
-Database::Database(const std::string& host, const std::string& user, 
-                   const std::string& password, const std::string& db_name)
-    : host(host), user(user), password(password), db_name(db_name), mysql(nullptr) {
+// Сколько раз повторяем запрос на новом соединении, если старое оказалось разорвано
+static constexpr int MAX_ATTEMPTS = 2;
+
+// Столбцы мода во всех выборках, в порядке parseModRow
+static const std::string MOD_COLUMNS = "id, name, description, link, category, downloads, views";
+
+// Подготовленные запросы горячего пути; кэшируются в каждом соединении пула
+static const std::string MOD_BY_ID_SQL =
+    "SELECT " + MOD_COLUMNS + " FROM mods WHERE id = ?";
+static const std::string MEDIA_BY_MOD_SQL =
+    "SELECT media_link FROM mod_media WHERE mod_id = ?";
+
+// Запас на транзакции, закоммиченные позже отметки времени, которую они записали в updated_at.
+// Повторное применение тех же строк безопасно
+static constexpr int WATERMARK_OVERLAP_SEC = 5;
+
+// Начальный размер буфера под строковый столбец; длинные значения дочитываются отдельно
+static constexpr unsigned long STRING_BUFFER_SIZE = 256;
+
+namespace {
+
+struct ColumnBinding {
+    unsigned long length = 0;
+    bool is_null = false;
+    bool error = false;
+};
+
+// Привязывает строковый столбец результата напрямую к буферу std::string
+void bindString(MYSQL_BIND& bind, std::string& target, ColumnBinding& column) {
+    if (target.size() < STRING_BUFFER_SIZE) {
+        target.resize(STRING_BUFFER_SIZE);
+    }
+    bind = MYSQL_BIND{};
+    bind.buffer_type = MYSQL_TYPE_STRING;
+    bind.buffer = &target[0];
+    bind.buffer_length = static_cast<unsigned long>(target.size());
+    bind.length = &column.length;
+    bind.is_null = &column.is_null;
+    bind.error = &column.error;
 }
 
-Database::~Database() {
-    if (mysql) {
-        mysql_close(mysql);
+// После mysql_stmt_fetch: дочитывает обрезанное значение и подрезает строку до фактической длины
+bool finishString(MYSQL_STMT* stmt, MYSQL_BIND& bind, std::string& target,
+                  ColumnBinding& column, unsigned int index) {
+    if (column.is_null) {
+        target.clear();
+        return true;
+    }
+    if (column.length > bind.buffer_length) {
+        target.resize(column.length);
+        MYSQL_BIND full = bind;
+        full.buffer = &target[0];
+        full.buffer_length = column.length;
+        if (mysql_stmt_fetch_column(stmt, &full, index, 0)) {
+            return false;
+        }
     }
+    target.resize(column.length);
+    return true;
 }
 
-bool Database::connectToDatabase() {
-    // Защищаем доступ к БД мьютексом
-    std::lock_guard<std::recursive_mutex> lock(db_mutex);
-    
-    mysql = mysql_init(nullptr);
-    if (!mysql) {
-        log_message("Error initializing MySQL", "ERROR");
-        return false;
+// id через запятую для IN (...); числа экранирования не требуют
+std::string joinIds(const std::vector<int>& ids) {
+    std::string joined;
+    for (int id : ids) {
+        if (!joined.empty()) joined += ",";
+        joined += std::to_string(id);
     }
+    return joined;
+}
 
-    // Устанавливаем таймаут подключения
-    int timeout = 5;
-    mysql_options(mysql, MYSQL_OPT_CONNECT_TIMEOUT, &timeout);
+// Строковый литерал SQL
+std::string quoted(MYSQL* mysql, const std::string& value) {
+    std::string escaped(value.size() * 2 + 1, '\0');
+    escaped.resize(mysql_real_escape_string(mysql, &escaped[0], value.c_str(),
+                                            static_cast<unsigned long>(value.size())));
+    return "'" + escaped + "'";
+}
 
-    // Включаем автоматическое переподключение
-    bool reconnect = 1;
-    mysql_options(mysql, MYSQL_OPT_RECONNECT, &reconnect);
+} // namespace
 
-    // Устанавливаем таймаут чтения
-    int read_timeout = 30;
-    mysql_options(mysql, MYSQL_OPT_READ_TIMEOUT, &read_timeout);
+// Запросы горячего пути готовятся на каждом соединении заранее, при его открытии в фоне
+static PoolOptions withWarmStatements(PoolOptions options) {
+    options.warm_statements = {MOD_BY_ID_SQL, MEDIA_BY_MOD_SQL};
+    return options;
+}
 
-    // Устанавливаем таймаут записи
-    int write_timeout = 30;
-    mysql_options(mysql, MYSQL_OPT_WRITE_TIMEOUT, &write_timeout);
+Database::Database(const PoolOptions& primary, const std::vector<PoolOptions>& replica_options)
+    : pool(withWarmStatements(primary)) {
+    for (const auto& options : replica_options) {
+        auto replica = std::make_unique<Replica>();
+        replica->host = options.host;
+        replica->pool = std::make_unique<ConnectionPool>(withWarmStatements(options));
+        replicas.push_back(std::move(replica));
+    }
+}
 
-    if (!mysql_real_connect(mysql, host.c_str(), user.c_str(), 
-                          password.c_str(), db_name.c_str(), 
-                          0, nullptr, 0)) {
-        log_message("Failed to connect to database: " + 
-                   std::string(mysql_error(mysql)), "ERROR");
-        return false;
+Database::ReadTarget::ReadTarget(ConnectionPool& pool, Replica* replica)
+    : pool_(&pool), replica_(replica) {
+    if (replica_) {
+        ++replica_->outstanding;
     }
+}
 
-    last_ping = std::chrono::steady_clock::now();
-    log_message("Successfully connected to database", "INFO");
-    return true;
+Database::ReadTarget::ReadTarget(ReadTarget&& other) noexcept
+    : pool_(other.pool_), replica_(other.replica_) {
+    other.replica_ = nullptr;
 }
 
-bool Database::reconnect() {
-    // Защищаем доступ к базе данных мьютексом
-    std::lock_guard<std::recursive_mutex> lock(db_mutex);
-    
-    if (mysql) {
-        mysql_close(mysql);
-        mysql = nullptr;
+Database::ReadTarget::~ReadTarget() {
+    if (replica_) {
+        --replica_->outstanding;
     }
-    return connectToDatabase();
 }
 
-bool Database::ping() {
-    // Защищаем доступ к базе данных мьютексом
-    std::lock_guard<std::recursive_mutex> lock(db_mutex);
-    
-    if (!mysql) return false;
-    return mysql_ping(mysql) == 0;
+void Database::ReadTarget::eject() {
+    if (replica_ && replica_->healthy.exchange(false)) {
+        log_message("Replica " + replica_->host + " failed on the request path, ejecting it", "WARNING");
+    }
 }
 
-bool Database::checkConnection() {
-    // Защищаем доступ к базе данных мьютексом
-    std::lock_guard<std::recursive_mutex> lock(db_mutex);
-    
-    auto now = std::chrono::steady_clock::now();
-    if (now - last_ping > PING_INTERVAL) {
-        if (!ping()) {
-            log_message("Lost connection to MySQL (ping failed), attempting to reconnect...", "WARNING");
-            return reconnect();
+Database::ReadTarget Database::pickReader(ReadRoute route) {
+    Replica* best = nullptr;
+    if (route == ReadRoute::Replica) {
+        for (auto& replica : replicas) {
+            if (!replica->healthy) continue;
+            if (!best || replica->outstanding < best->outstanding) {
+                best = replica.get();
+            }
         }
-        last_ping = now;
     }
-    return true;
+    if (!best) {
+        return ReadTarget(pool, nullptr);
+    }
+    return ReadTarget(*best->pool, best);
 }
 
-std::vector<ModData> Database::getAllMods() {
-    std::vector<ModData> mods;
-    
-    // Защищаем доступ к базе данных мьютексом
-    std::lock_guard<std::recursive_mutex> lock(db_mutex);
-    
-    if (!checkConnection()) {
-        log_message("Database connection check failed", "ERROR");
-        return mods;
-    }
-
-    const char* query = "SELECT id, name, description, link, category FROM mods";
-    
-    if (mysql_query(mysql, query)) {
-        std::string error = mysql_error(mysql);
-        log_message("Error executing query: " + error, "ERROR");
-        
-        if (error.find("Lost connection") != std::string::npos) {
-            log_message("Attempting to reconnect to database...", "INFO");
-            if (reconnect() && !mysql_query(mysql, query)) {
-                MYSQL_RES* result = mysql_store_result(mysql);
-                if (result) {
-                    processMySQLResult(result, mods);
-                    mysql_free_result(result);
-                    return mods;
-                }
+void Database::checkReplicas() {
+    for (auto& replica : replicas) {
+        bool ok = false;
+        auto conn = replica->pool->acquire();
+        if (conn) {
+            QueryTimer timer(QueryKind::Ping, "PING", mysql_thread_id(conn.get()));
+            ok = mysql_ping(conn.get()) == 0;
+            timer.finish(ok);
+            if (!ok) {
+                conn.markBroken();
+            }
+        }
+
+        if (ok) {
+            replica->failures = 0;
+            ++replica->successes;
+            if (!replica->healthy && replica->successes >= READMIT_AFTER_SUCCESSES) {
+                replica->healthy = true;
+                log_message("Replica " + replica->host + " is healthy again, readmitting it", "INFO");
+            }
+        } else {
+            replica->successes = 0;
+            ++replica->failures;
+            if (replica->healthy && replica->failures >= EJECT_AFTER_FAILURES) {
+                replica->healthy = false;
+                log_message("Replica " + replica->host + " failed health checks, ejecting it", "WARNING");
             }
         }
-        return mods;
     }
+}
 
-    MYSQL_RES* result = mysql_store_result(mysql);
-    if (result) {
-        processMySQLResult(result, mods);
-        mysql_free_result(result);
+void Database::maintain() {
+    pool.maintain();
+    checkReplicas();
+    // Исключённые реплики не восполняем: каждая попытка ждала бы таймаута подключения
+    for (auto& replica : replicas) {
+        if (replica->healthy) {
+            replica->pool->maintain();
+        }
     }
-    
-    return mods;
 }
 
-void Database::processMySQLResult(MYSQL_RES* result, std::vector<ModData>& mods) {
-    MYSQL_ROW row;
-    while ((row = mysql_fetch_row(result))) {
-        ModData mod;
-        mod.id = row[0] ? std::stoi(row[0]) : 0;
-        mod.name = row[1] ? row[1] : "";
-        mod.description = row[2] ? row[2] : "";
-        mod.link = row[3] ? row[3] : "";
-        mod.category = row[4] ? row[4] : "Общее";
-
-        std::string media_query = "SELECT media_link FROM mod_media WHERE mod_id = " + std::to_string(mod.id);
-        if (!mysql_query(mysql, media_query.c_str())) {
-            MYSQL_RES* media_result = mysql_store_result(mysql);
-            if (media_result) {
-                MYSQL_ROW media_row;
-                while ((media_row = mysql_fetch_row(media_result))) {
-                    if (media_row[0]) {
-                        mod.media_links.push_back(media_row[0]);
-                    }
+Database::~Database() {
+}
+
+bool Database::connectToDatabase() {
+    if (!pool.start()) {
+        return false;
+    }
+
+    // Недоступная при старте реплика не мешает запуску: её вернёт фоновая проверка
+    for (auto& replica : replicas) {
+        replica->healthy = replica->pool->start();
+        log_message("Replica " + replica->host + (replica->healthy ? " connected" : " is unavailable"),
+                    replica->healthy ? "INFO" : "WARNING");
+    }
+
+    log_message("Successfully connected to database", "INFO");
+    return true;
+}
+
+bool Database::ping() {
+    auto conn = pool.acquire();
+    if (!conn) return false;
+
+    QueryTimer timer(QueryKind::Ping, "PING", mysql_thread_id(conn.get()));
+    if (mysql_ping(conn.get()) != 0) {
+        conn.markBroken();
+        return false;
+    }
+    timer.finish(true);
+    return true;
+}
+
+bool Database::isConnectionLost(unsigned int err) {
+    return err == CR_SERVER_GONE_ERROR || err == CR_SERVER_LOST || err == CR_SERVER_LOST_EXTENDED;
+}
+
+bool Database::streamAllMods(const ModConsumer& consume) {
+    // Оба запроса упорядочены по id мода, поэтому медиа подклеиваются слиянием двух потоков
+    // строк, без промежуточного хранения результата в клиентской библиотеке
+    const std::string mods_query = "SELECT " + MOD_COLUMNS + " FROM mods ORDER BY id";
+    const char* media_query = "SELECT mod_id, media_link FROM mod_media ORDER BY mod_id";
+
+    for (int attempt = 0; attempt < MAX_ATTEMPTS; ++attempt) {
+        // Оба соединения берутся разом: две одновременные загрузки, взявшие по одному,
+        // ждали бы друг друга до таймаута
+        auto connections = pool.acquire(2);
+        if (connections.size() < 2) {
+            log_message("Database connection check failed", "ERROR");
+            return false;
+        }
+        auto& mods_conn = connections[0];
+        auto& media_conn = connections[1];
+
+        auto started = std::chrono::steady_clock::now();
+        // Замер охватывает весь поток: запросы, чтение строк и сборку модов
+        QueryTimer timer(QueryKind::AllMods, mods_query.c_str(), mysql_thread_id(mods_conn.get()));
+        if (mysql_query(mods_conn.get(), mods_query.c_str()) || mysql_query(media_conn.get(), media_query)) {
+            log_message("Error executing query: " + std::string(mysql_error(mods_conn.get())) +
+                        std::string(mysql_error(media_conn.get())), "ERROR");
+            bool lost = isConnectionLost(mysql_errno(mods_conn.get())) ||
+                        isConnectionLost(mysql_errno(media_conn.get()));
+            // На соединении может остаться непрочитанная выборка - не переиспользуем их
+            mods_conn.markBroken();
+            media_conn.markBroken();
+            if (lost) {
+                log_message("Attempting to reconnect to database...", "INFO");
+                continue;
+            }
+            return false;
+        }
+
+        MYSQL_RES* mods_result = mysql_use_result(mods_conn.get());
+        MYSQL_RES* media_result = mods_result ? mysql_use_result(media_conn.get()) : nullptr;
+        if (!mods_result || !media_result) {
+            log_message("Error getting results: " + std::string(mysql_error(mods_conn.get())) +
+                        std::string(mysql_error(media_conn.get())), "ERROR");
+            if (mods_result) mysql_free_result(mods_result);
+            // Состояние соединений после неудачного запроса неизвестно - не переиспользуем их
+            mods_conn.markBroken();
+            media_conn.markBroken();
+            return false;
+        }
+
+        std::size_t count = 0;
+        MYSQL_ROW media_row = mysql_fetch_row(media_result);
+        MYSQL_ROW row;
+        while ((row = mysql_fetch_row(mods_result))) {
+            ModData mod = parseModRow(row);
+
+            // Пропускаем медиа модов, которых нет в таблице mods
+            while (media_row && (!media_row[0] || std::stoi(media_row[0]) < mod.id)) {
+                media_row = mysql_fetch_row(media_result);
+            }
+            while (media_row && media_row[0] && std::stoi(media_row[0]) == mod.id) {
+                if (media_row[1]) {
+                    mod.media_links.emplace_back(media_row[1]);
                 }
-                mysql_free_result(media_result);
+                media_row = mysql_fetch_row(media_result);
             }
+
+            consume(std::move(mod));
+            ++count;
+        }
+
+        // mysql_fetch_row возвращает NULL и в конце выборки, и при обрыве - различаем по mysql_errno
+        bool failed = mysql_errno(mods_conn.get()) != 0 || mysql_errno(media_conn.get()) != 0;
+        if (failed) {
+            log_message("Error streaming catalog rows: " + std::string(mysql_error(mods_conn.get())) +
+                        std::string(mysql_error(media_conn.get())), "ERROR");
+            if (isConnectionLost(mysql_errno(mods_conn.get()))) mods_conn.markBroken();
+            if (isConnectionLost(mysql_errno(media_conn.get()))) media_conn.markBroken();
         }
-        
-        mods.push_back(mod);
+        mysql_free_result(mods_result);
+        mysql_free_result(media_result);
+        if (failed) {
+            return false;
+        }
+
+        timer.finish(true, count);
+        auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now() - started);
+        log_message("Streamed " + std::to_string(count) + " mods with media in 2 queries, " +
+                    std::to_string(elapsed.count()) + " ms", "DEBUG");
+        return true;
     }
+
+    return false;
 }
 
-std::optional<ModData> Database::getModById(int mod_id) {
-    // Защищаем доступ к базе данных мьютексом
-    std::lock_guard<std::recursive_mutex> lock(db_mutex);
-    
-    if (!mysql) {
-        log_message("Not connected to database", "ERROR");
-        return std::nullopt;
-    }
-    
-    std::string query = "SELECT id, name, description, link FROM mods WHERE id = " + std::to_string(mod_id);
+bool Database::querySingleValue(MYSQL* mysql, const std::string& query, std::string& value) {
+    QueryTimer timer(QueryKind::ServerTime, query.c_str(), mysql_thread_id(mysql));
     if (mysql_query(mysql, query.c_str())) {
         log_message("Error executing query: " + std::string(mysql_error(mysql)), "ERROR");
-        return std::nullopt;
+        return false;
     }
-    
+
     MYSQL_RES* result = mysql_store_result(mysql);
     if (!result) {
         log_message("Error getting results: " + std::string(mysql_error(mysql)), "ERROR");
-        return std::nullopt;
+        return false;
     }
-    
+
     MYSQL_ROW row = mysql_fetch_row(result);
-    if (!row) {
-        mysql_free_result(result);
+    bool found = row && row[0];
+    if (found) {
+        value = row[0];
+    }
+    mysql_free_result(result);
+    timer.finish(found, found ? 1 : 0);
+    return found;
+}
+
+std::optional<std::string> Database::getServerTime() {
+    auto conn = pool.acquire();
+    if (!conn) {
+        log_message("Not connected to database", "ERROR");
+        return std::nullopt;
+    }
+
+    std::string now;
+    if (!querySingleValue(conn.get(), "SELECT NOW(6)", now)) {
+        if (isConnectionLost(mysql_errno(conn.get()))) {
+            conn.markBroken();
+        }
         return std::nullopt;
     }
-    
+    return now;
+}
+
+std::optional<ModChanges> Database::getModChanges(const std::string& since) {
+    for (int attempt = 0; attempt < MAX_ATTEMPTS; ++attempt) {
+        auto conn = pool.acquire();
+        if (!conn) {
+            log_message("Not connected to database", "ERROR");
+            return std::nullopt;
+        }
+        MYSQL* mysql = conn.get();
+
+        // Любой из запросов, потерявший соединение, повторяет всю выборку на новом
+        auto retry = [&conn, mysql]() {
+            if (!isConnectionLost(mysql_errno(mysql))) {
+                return false;
+            }
+            conn.markBroken();
+            return true;
+        };
+        auto select = [mysql](const std::string& query) -> MYSQL_RES* {
+            if (mysql_query(mysql, query.c_str())) {
+                log_message("Error executing query: " + std::string(mysql_error(mysql)), "ERROR");
+                return nullptr;
+            }
+            MYSQL_RES* result = mysql_store_result(mysql);
+            if (!result) {
+                log_message("Error getting results: " + std::string(mysql_error(mysql)), "ERROR");
+            }
+            return result;
+        };
+
+        ModChanges changes;
+        // Отметку берём до выборки: всё, что изменится во время неё, попадёт в следующую
+        if (!querySingleValue(mysql, "SELECT NOW(6)", changes.watermark)) {
+            if (retry()) continue;
+            return std::nullopt;
+        }
+
+        std::string escaped(since.size() * 2 + 1, '\0');
+        escaped.resize(mysql_real_escape_string(mysql, &escaped[0], since.c_str(),
+                                                static_cast<unsigned long>(since.size())));
+        std::string since_clause = ">= DATE_SUB('" + escaped + "', INTERVAL " +
+                                   std::to_string(WATERMARK_OVERLAP_SEC) + " SECOND)";
+
+        std::string query = "SELECT " + MOD_COLUMNS + " FROM mods WHERE updated_at " + since_clause;
+        QueryTimer changes_timer(QueryKind::Changes, query.c_str(), mysql_thread_id(mysql));
+        MYSQL_RES* result = select(query);
+        if (!result) {
+            if (retry()) continue;
+            return std::nullopt;
+        }
+        processMySQLResult(result, changes.updated);
+        mysql_free_result(result);
+        changes_timer.finish(true, changes.updated.size());
+
+        if (!changes.updated.empty()) {
+            std::string ids;
+            for (const auto& mod : changes.updated) {
+                if (!ids.empty()) ids += ",";
+                ids += std::to_string(mod.id);
+            }
+            if (!loadMediaLinks(mysql, changes.updated, "WHERE mod_id IN (" + ids + ")")) {
+                if (retry()) continue;
+                return std::nullopt;
+            }
+        }
+
+        std::string tombstones_query = "SELECT mod_id FROM mod_tombstones WHERE deleted_at " + since_clause;
+        QueryTimer tombstones_timer(QueryKind::Changes, tombstones_query.c_str(), mysql_thread_id(mysql));
+        result = select(tombstones_query);
+        if (!result) {
+            if (retry()) continue;
+            return std::nullopt;
+        }
+        MYSQL_ROW row;
+        while ((row = mysql_fetch_row(result))) {
+            if (row[0]) {
+                changes.deleted.push_back(std::stoi(row[0]));
+            }
+        }
+        mysql_free_result(result);
+        tombstones_timer.finish(true, changes.deleted.size());
+
+        return changes;
+    }
+
+    return std::nullopt;
+}
+
+bool Database::getModsByIds(const std::vector<int>& mod_ids, std::vector<ModData>& found) {
+    found.clear();
+    if (mod_ids.empty()) {
+        return true;
+    }
+
+    // id подставляются числами, экранирование не требуется
+    std::string ids;
+    for (int mod_id : mod_ids) {
+        if (!ids.empty()) ids += ",";
+        ids += std::to_string(mod_id);
+    }
+    std::string query = "SELECT " + MOD_COLUMNS + " FROM mods WHERE id IN (" + ids + ")";
+
+    for (int attempt = 0; attempt < MAX_ATTEMPTS; ++attempt) {
+        auto target = pickReader(ReadRoute::Replica);
+        auto conn = target.pool().acquire();
+        if (!conn) {
+            log_message("Not connected to database", "ERROR");
+            if (target.isReplica()) {
+                target.eject();
+                continue;
+            }
+            return false;
+        }
+        MYSQL* mysql = conn.get();
+
+        QueryTimer timer(QueryKind::Batch, query.c_str(), mysql_thread_id(mysql));
+        if (mysql_query(mysql, query.c_str())) {
+            log_message("Error executing query: " + std::string(mysql_error(mysql)), "ERROR");
+            if (isConnectionLost(mysql_errno(mysql))) {
+                conn.markBroken();
+                continue;
+            }
+            return false;
+        }
+
+        MYSQL_RES* result = mysql_store_result(mysql);
+        if (!result) {
+            log_message("Error getting results: " + std::string(mysql_error(mysql)), "ERROR");
+            if (isConnectionLost(mysql_errno(mysql))) {
+                conn.markBroken();
+                continue;
+            }
+            return false;
+        }
+        std::vector<ModData> mods;
+        processMySQLResult(result, mods);
+        mysql_free_result(result);
+        timer.finish(true, mods.size());
+
+        if (!mods.empty() && !loadMediaLinks(mysql, mods, "WHERE mod_id IN (" + ids + ")")) {
+            if (isConnectionLost(mysql_errno(mysql))) {
+                conn.markBroken();
+                continue;
+            }
+            return false;
+        }
+
+        found = std::move(mods);
+        return true;
+    }
+
+    return false;
+}
+
+bool Database::execute(MYSQL* mysql, const std::string& query) {
+    QueryTimer timer(QueryKind::Write, query.c_str(), mysql_thread_id(mysql));
+    if (mysql_query(mysql, query.c_str())) {
+        log_message("Error executing query: " + std::string(mysql_error(mysql)), "ERROR");
+        return false;
+    }
+    timer.finish(true, mysql_affected_rows(mysql));
+    return true;
+}
+
+bool Database::applyWrites(const std::vector<ModWrite>& writes, std::vector<ModWriteResult>& results) {
+    results.assign(writes.size(), ModWriteResult{});
+    if (writes.empty()) {
+        return true;
+    }
+
+    for (int attempt = 0; attempt < MAX_ATTEMPTS; ++attempt) {
+        auto conn = pool.acquire();
+        if (!conn) {
+            log_message("Not connected to database", "ERROR");
+            return false;
+        }
+        MYSQL* mysql = conn.get();
+
+        bool committing = false;
+        if (runWriteTransaction(mysql, writes, results, committing)) {
+            return true;
+        }
+
+        unsigned int err = mysql_errno(mysql);
+        if (isConnectionLost(err)) {
+            conn.markBroken();
+            if (committing) {
+                // Неизвестно, успел ли сервер зафиксировать транзакцию; повтор мог бы задвоить моды
+                log_message("Connection lost during COMMIT, write batch outcome unknown", "ERROR");
+                return false;
+            }
+            results.assign(writes.size(), ModWriteResult{});
+            continue;
+        }
+
+        mysql_query(mysql, "ROLLBACK");
+        results.assign(writes.size(), ModWriteResult{});
+        if (err == ER_LOCK_DEADLOCK || err == ER_LOCK_WAIT_TIMEOUT) {
+            continue;
+        }
+        if (err == 0) {
+            return false;
+        }
+        // Сервер отверг данные: одна плохая запись не должна отменять остальные
+        if (writes.size() > 1) {
+            return applyWritesOneByOne(writes, results);
+        }
+        results[0].status = ModWriteResult::Status::Rejected;
+        return true;
+    }
+
+    return false;
+}
+
+bool Database::applyWritesOneByOne(const std::vector<ModWrite>& writes, std::vector<ModWriteResult>& results) {
+    log_message("Write batch of " + std::to_string(writes.size()) + " rejected, applying writes one by one", "WARNING");
+    for (std::size_t i = 0; i < writes.size(); ++i) {
+        std::vector<ModWriteResult> single;
+        if (!applyWrites({writes[i]}, single)) {
+            // Хранилище стало недоступно: оставшиеся записи не применены
+            for (std::size_t j = i; j < writes.size(); ++j) {
+                results[j].status = ModWriteResult::Status::Unavailable;
+            }
+            return true;
+        }
+        results[i] = std::move(single[0]);
+    }
+    return true;
+}
+
+CounterWriteStatus Database::addCounters(const std::vector<ModCounterDelta>& deltas) {
+    if (deltas.empty()) {
+        return CounterWriteStatus::Saved;
+    }
+
+    // Одинаковый порядок строк во всех транзакциях не даёт им взаимно заблокироваться
+    std::vector<ModCounterDelta> sorted = deltas;
+    std::sort(sorted.begin(), sorted.end(),
+              [](const ModCounterDelta& a, const ModCounterDelta& b) { return a.mod_id < b.mod_id; });
+
+    std::vector<std::string> statements;
+    for (std::size_t begin = 0; begin < sorted.size(); begin += COUNTER_CHUNK) {
+        std::size_t end = std::min(begin + COUNTER_CHUNK, sorted.size());
+        std::string downloads;
+        std::string views;
+        std::vector<int> ids;
+        for (std::size_t i = begin; i < end; ++i) {
+            const auto& delta = sorted[i];
+            std::string when = " WHEN " + std::to_string(delta.mod_id) + " THEN ";
+            if (delta.downloads) downloads += when + std::to_string(delta.downloads);
+            if (delta.views) views += when + std::to_string(delta.views);
+            ids.push_back(delta.mod_id);
+        }
+
+        std::string assignments;
+        if (!downloads.empty()) {
+            assignments = "downloads = downloads + CASE id" + downloads + " ELSE 0 END";
+        }
+        if (!views.empty()) {
+            if (!assignments.empty()) assignments += ", ";
+            assignments += "views = views + CASE id" + views + " ELSE 0 END";
+        }
+        if (!assignments.empty()) {
+            statements.push_back("UPDATE mods SET " + assignments + " WHERE id IN (" + joinIds(ids) + ")");
+        }
+    }
+
+    for (int attempt = 0; attempt < MAX_ATTEMPTS; ++attempt) {
+        auto conn = pool.acquire();
+        if (!conn) {
+            log_message("Not connected to database", "ERROR");
+            return CounterWriteStatus::Failed;
+        }
+        MYSQL* mysql = conn.get();
+
+        bool ok = execute(mysql, "START TRANSACTION");
+        for (std::size_t i = 0; ok && i < statements.size(); ++i) {
+            ok = execute(mysql, statements[i]);
+        }
+        if (ok) {
+            if (execute(mysql, "COMMIT")) {
+                return CounterWriteStatus::Saved;
+            }
+            if (isConnectionLost(mysql_errno(mysql))) {
+                // Сохранены ли приращения, неизвестно. Повтор мог бы посчитать их дважды;
+                // теряем не больше одного сброса
+                conn.markBroken();
+                log_message("Connection lost during COMMIT, counter deltas may be lost", "ERROR");
+                return CounterWriteStatus::Unknown;
+            }
+        }
+
+        unsigned int err = mysql_errno(mysql);
+        if (isConnectionLost(err)) {
+            conn.markBroken();
+            continue;
+        }
+        mysql_query(mysql, "ROLLBACK");
+        if (err != ER_LOCK_DEADLOCK && err != ER_LOCK_WAIT_TIMEOUT) {
+            return CounterWriteStatus::Failed;
+        }
+    }
+
+    return CounterWriteStatus::Failed;
+}
+
+bool Database::runWriteTransaction(MYSQL* mysql, const std::vector<ModWrite>& writes,
+                                   std::vector<ModWriteResult>& results, bool& committing) {
+    committing = false;
+    if (!execute(mysql, "START TRANSACTION")) {
+        return false;
+    }
+
+    // Текущие строки всех модов, на которые ссылаются записи, блокируются до COMMIT
+    std::vector<int> ids;
+    for (const auto& write : writes) {
+        if (write.id > 0) {
+            ids.push_back(write.id);
+        }
+    }
+    std::unordered_map<int, std::optional<ModData>> state;
+    std::unordered_set<int> existing;
+    if (!ids.empty()) {
+        std::string query = "SELECT " + MOD_COLUMNS + " FROM mods WHERE id IN (" +
+                            joinIds(ids) + ") FOR UPDATE";
+        QueryTimer timer(QueryKind::Write, query.c_str(), mysql_thread_id(mysql));
+        if (mysql_query(mysql, query.c_str())) {
+            log_message("Error executing query: " + std::string(mysql_error(mysql)), "ERROR");
+            return false;
+        }
+        MYSQL_RES* result = mysql_store_result(mysql);
+        if (!result) {
+            log_message("Error getting results: " + std::string(mysql_error(mysql)), "ERROR");
+            return false;
+        }
+        std::vector<ModData> mods;
+        processMySQLResult(result, mods);
+        mysql_free_result(result);
+        timer.finish(true, mods.size());
+
+        if (!loadMediaLinks(mysql, mods, "WHERE mod_id IN (" + joinIds(ids) + ")")) {
+            return false;
+        }
+        for (int mod_id : ids) {
+            state.emplace(mod_id, std::nullopt);
+        }
+        for (auto& mod : mods) {
+            existing.insert(mod.id);
+            state[mod.id] = std::move(mod);
+        }
+    }
+
+    // Проигрываем записи по порядку поверх прочитанных строк; в БД уходит только итог по каждому id
+    std::vector<std::size_t> auto_adds;
+    std::vector<int> touched;
+    std::unordered_set<int> media_changed;
+    for (std::size_t i = 0; i < writes.size(); ++i) {
+        const auto& write = writes[i];
+        auto& result = results[i];
+        if (write.op == ModWrite::Op::Add && write.id <= 0) {
+            auto_adds.push_back(i);
+            continue;
+        }
+
+        auto& current = state[write.id];
+        if (write.op == ModWrite::Op::Add) {
+            if (current) {
+                result.status = ModWriteResult::Status::Conflict;
+                continue;
+            }
+            current.emplace();
+            current->id = write.id;
+            current->category = "Общее";
+            merge_mod_write(*current, write);
+            media_changed.insert(write.id);
+        } else if (!current) {
+            result.status = ModWriteResult::Status::NotFound;
+            continue;
+        } else if (write.op == ModWrite::Op::Update) {
+            merge_mod_write(*current, write);
+            if (write.media_links) {
+                media_changed.insert(write.id);
+            }
+        } else {
+            current.reset();
+            media_changed.insert(write.id);
+        }
+
+        touched.push_back(write.id);
+        result.status = ModWriteResult::Status::Ok;
+        if (current) {
+            result.mod = *current;
+        } else {
+            result.mod.id = write.id;
+        }
+    }
+
+    auto row_values = [mysql](const ModData& mod) {
+        return quoted(mysql, mod.name) + "," + quoted(mysql, mod.description) + "," +
+               quoted(mysql, mod.link) + "," + quoted(mysql, mod.category) + ",NOW(6)";
+    };
+
+    std::string upserts;
+    std::vector<int> deleted;
+    std::unordered_set<int> written;
+    for (int mod_id : touched) {
+        if (!written.insert(mod_id).second) {
+            continue;
+        }
+        const auto& current = state[mod_id];
+        if (current) {
+            if (!upserts.empty()) upserts += ",";
+            upserts += "(" + std::to_string(mod_id) + "," + row_values(*current) + ")";
+        } else if (existing.count(mod_id)) {
+            deleted.push_back(mod_id);
+        }
+    }
+
+    if (!upserts.empty() &&
+        !execute(mysql, "INSERT INTO mods (id, name, description, link, category, updated_at) VALUES " + upserts +
+                        " ON DUPLICATE KEY UPDATE name = VALUES(name), description = VALUES(description), "
+                        "link = VALUES(link), category = VALUES(category), updated_at = VALUES(updated_at)")) {
+        return false;
+    }
+
+    // Новые моды вставляются по одному: id строки многострочного INSERT нельзя вычислить
+    // из mysql_insert_id, шаг зависит от auto_increment_increment и режима блокировки
+    for (std::size_t i : auto_adds) {
+        auto& result = results[i];
+        ModData& mod = result.mod;
+        mod.category = "Общее";
+        merge_mod_write(mod, writes[i]);
+        if (!execute(mysql, "INSERT INTO mods (name, description, link, category, updated_at) VALUES (" +
+                            row_values(mod) + ")")) {
+            return false;
+        }
+        mod.id = static_cast<int>(mysql_insert_id(mysql));
+        result.status = ModWriteResult::Status::Ok;
+        state[mod.id] = mod;
+        media_changed.insert(mod.id);
+    }
+
+    if (!media_changed.empty()) {
+        std::vector<int> media_ids(media_changed.begin(), media_changed.end());
+        if (!execute(mysql, "DELETE FROM mod_media WHERE mod_id IN (" + joinIds(media_ids) + ")")) {
+            return false;
+        }
+        std::string media;
+        for (int mod_id : media_ids) {
+            const auto& current = state[mod_id];
+            if (!current) continue;
+            for (const auto& link : current->media_links) {
+                if (!media.empty()) media += ",";
+                media += "(" + std::to_string(mod_id) + "," + quoted(mysql, link) + ")";
+            }
+        }
+        if (!media.empty() && !execute(mysql, "INSERT INTO mod_media (mod_id, media_link) VALUES " + media)) {
+            return false;
+        }
+    }
+
+    if (!deleted.empty()) {
+        std::string tombstones;
+        for (int mod_id : deleted) {
+            if (!tombstones.empty()) tombstones += ",";
+            tombstones += "(" + std::to_string(mod_id) + ",NOW(6))";
+        }
+        if (!execute(mysql, "DELETE FROM mods WHERE id IN (" + joinIds(deleted) + ")") ||
+            !execute(mysql, "INSERT INTO mod_tombstones (mod_id, deleted_at) VALUES " + tombstones)) {
+            return false;
+        }
+    }
+
+    committing = true;
+    if (!execute(mysql, "COMMIT")) {
+        return false;
+    }
+    log_message("Committed write batch: " + std::to_string(writes.size()) + " writes, " +
+                std::to_string(auto_adds.size()) + " new mods, " + std::to_string(deleted.size()) +
+                " deleted", "DEBUG");
+    return true;
+}
+
+void Database::processMySQLResult(MYSQL_RES* result, std::vector<ModData>& mods) {
+    mods.reserve(mods.size() + static_cast<std::size_t>(mysql_num_rows(result)));
+
+    MYSQL_ROW row;
+    while ((row = mysql_fetch_row(result))) {
+        mods.push_back(parseModRow(row));
+    }
+}
+
+ModData Database::parseModRow(MYSQL_ROW row) {
     ModData mod;
-    mod.id = std::stoi(row[0]);
+    mod.id = row[0] ? std::stoi(row[0]) : 0;
     mod.name = row[1] ? row[1] : "";
     mod.description = row[2] ? row[2] : "";
     mod.link = row[3] ? row[3] : "";
-    
-    // Get the media links
-    query = "SELECT media_link FROM mod_media WHERE mod_id = " + std::to_string(mod.id);
-    if (!mysql_query(mysql, query.c_str())) {
-        MYSQL_RES* media_result = mysql_store_result(mysql);
-        if (media_result) {
-            MYSQL_ROW media_row;
-            while ((media_row = mysql_fetch_row(media_result))) {
-                if (media_row[0]) {
-                    mod.media_links.push_back(media_row[0]);
-                }
+    mod.category = row[4] ? row[4] : "Общее";
+    mod.downloads = row[5] ? std::stoull(row[5]) : 0;
+    mod.views = row[6] ? std::stoull(row[6]) : 0;
+    return mod;
+}
+
+bool Database::loadMediaLinks(MYSQL* mysql, std::vector<ModData>& mods, const std::string& filter) {
+    if (mods.empty()) return true;
+
+    // Одним запросом забираем медиа для всего каталога и раскладываем по модам в памяти,
+    // вместо отдельного запроса на каждую строку
+    std::unordered_map<int, std::size_t> index_by_id;
+    index_by_id.reserve(mods.size());
+    for (std::size_t i = 0; i < mods.size(); ++i) {
+        index_by_id.emplace(mods[i].id, i);
+    }
+
+    std::string query = "SELECT mod_id, media_link FROM mod_media " + filter + " ORDER BY mod_id";
+    QueryTimer timer(QueryKind::Media, query.c_str(), mysql_thread_id(mysql));
+    if (mysql_query(mysql, query.c_str())) {
+        log_message("Error executing media query: " + std::string(mysql_error(mysql)), "ERROR");
+        return false;
+    }
+
+    MYSQL_RES* media_result = mysql_store_result(mysql);
+    if (!media_result) {
+        log_message("Error getting media results: " + std::string(mysql_error(mysql)), "ERROR");
+        return false;
+    }
+
+    MYSQL_ROW media_row;
+    while ((media_row = mysql_fetch_row(media_result))) {
+        if (!media_row[0] || !media_row[1]) continue;
+
+        auto it = index_by_id.find(std::stoi(media_row[0]));
+        if (it != index_by_id.end()) {
+            mods[it->second].media_links.emplace_back(media_row[1]);
+        }
+    }
+    timer.finish(true, mysql_num_rows(media_result));
+    mysql_free_result(media_result);
+    return true;
+}
+
+bool Database::loadMediaLinks(ConnectionPool::Handle& conn, ModData& mod) {
+    MYSQL_STMT* stmt = conn.prepare(MEDIA_BY_MOD_SQL);
+    if (!stmt) return false;
+
+    QueryTimer timer(QueryKind::Media, MEDIA_BY_MOD_SQL.c_str(), mysql_thread_id(conn.get()));
+    MYSQL_BIND param{};
+    param.buffer_type = MYSQL_TYPE_LONG;
+    param.buffer = &mod.id;
+
+    if (mysql_stmt_bind_param(stmt, &param) || mysql_stmt_execute(stmt)) {
+        log_message("Error executing media statement: " + std::string(mysql_stmt_error(stmt)), "ERROR");
+        if (isConnectionLost(mysql_stmt_errno(stmt))) {
+            conn.markBroken();
+        } else {
+            conn.discardStatement(MEDIA_BY_MOD_SQL);
+        }
+        return false;
+    }
+
+    std::string link;
+    ColumnBinding column;
+    MYSQL_BIND result{};
+
+    int rc = 0;
+    while (true) {
+        bindString(result, link, column);
+        if (mysql_stmt_bind_result(stmt, &result)) {
+            rc = 1;
+            break;
+        }
+
+        rc = mysql_stmt_fetch(stmt);
+        if (rc == 1 || rc == MYSQL_NO_DATA) break;
+        if (!finishString(stmt, result, link, column, 0)) {
+            rc = 1;
+            break;
+        }
+        if (!column.is_null) {
+            mod.media_links.push_back(link);
+        }
+    }
+    // Ошибку запоминаем до mysql_stmt_free_result
+    unsigned int err = rc == 1 ? mysql_stmt_errno(stmt) : 0;
+    std::string error = rc == 1 ? mysql_stmt_error(stmt) : "";
+    mysql_stmt_free_result(stmt);
+
+    if (rc == 1) {
+        log_message("Error fetching media rows: " + error, "ERROR");
+        if (isConnectionLost(err)) {
+            conn.markBroken();
+        } else {
+            conn.discardStatement(MEDIA_BY_MOD_SQL);
+        }
+        return false;
+    }
+    timer.finish(true, mod.media_links.size());
+    return true;
+}
+
+bool Database::getModById(int mod_id, std::optional<ModData>& found) {
+    found.reset();
+    for (int attempt = 0; attempt < MAX_ATTEMPTS; ++attempt) {
+        auto target = pickReader(ReadRoute::Replica);
+        auto conn = target.pool().acquire();
+        if (!conn) {
+            log_message("Not connected to database", "ERROR");
+            if (target.isReplica()) {
+                target.eject();
+                continue;
+            }
+            return false;
+        }
+
+        MYSQL_STMT* stmt = conn.prepare(MOD_BY_ID_SQL);
+        if (!stmt) {
+            if (isConnectionLost(mysql_errno(conn.get()))) {
+                conn.markBroken();
+                continue;
+            }
+            return false;
+        }
+
+        // Медиа замеряются отдельно, в by_id входит только сам мод
+        QueryTimer timer(QueryKind::ById, MOD_BY_ID_SQL.c_str(), mysql_thread_id(conn.get()));
+        MYSQL_BIND param{};
+        param.buffer_type = MYSQL_TYPE_LONG;
+        param.buffer = &mod_id;
+
+        if (mysql_stmt_bind_param(stmt, &param) || mysql_stmt_execute(stmt)) {
+            log_message("Error executing query: " + std::string(mysql_stmt_error(stmt)), "ERROR");
+            if (isConnectionLost(mysql_stmt_errno(stmt))) {
+                conn.markBroken();
+                continue;
+            }
+            conn.discardStatement(MOD_BY_ID_SQL);
+            return false;
+        }
+
+        // Бинарный протокол: id приходит сразу числом, строки пишутся прямо в поля ModData
+        ModData mod;
+        MYSQL_BIND result[7] = {};
+        ColumnBinding columns[7];
+        std::string* strings[] = {nullptr, &mod.name, &mod.description, &mod.link, &mod.category};
+
+        result[0].buffer_type = MYSQL_TYPE_LONG;
+        result[0].buffer = &mod.id;
+        result[0].is_null = &columns[0].is_null;
+        result[0].error = &columns[0].error;
+        for (unsigned i = 1; i < 5; ++i) {
+            bindString(result[i], *strings[i], columns[i]);
+        }
+        std::uint64_t* counters[] = {&mod.downloads, &mod.views};
+        for (unsigned i = 5; i < 7; ++i) {
+            result[i].buffer_type = MYSQL_TYPE_LONGLONG;
+            result[i].is_unsigned = true;
+            result[i].buffer = counters[i - 5];
+            result[i].is_null = &columns[i].is_null;
+            result[i].error = &columns[i].error;
+        }
+
+        if (mysql_stmt_bind_result(stmt, result)) {
+            log_message("Error binding results: " + std::string(mysql_stmt_error(stmt)), "ERROR");
+            mysql_stmt_free_result(stmt);
+            return false;
+        }
+
+        int rc = mysql_stmt_fetch(stmt);
+        if (rc == MYSQL_NO_DATA) {
+            // Мода нет - это успешный ответ, а не ошибка
+            mysql_stmt_free_result(stmt);
+            timer.finish(true, 0);
+            return true;
+        }
+        if (rc == 1) {
+            log_message("Error getting results: " + std::string(mysql_stmt_error(stmt)), "ERROR");
+            bool lost = isConnectionLost(mysql_stmt_errno(stmt));
+            mysql_stmt_free_result(stmt);
+            if (lost) {
+                conn.markBroken();
+                continue;
             }
-            mysql_free_result(media_result);
+            return false;
+        }
+
+        bool complete = true;
+        for (unsigned i = 1; i < 5; ++i) {
+            complete = finishString(stmt, result[i], *strings[i], columns[i], i) && complete;
+        }
+        mysql_stmt_free_result(stmt);
+
+        if (!complete) {
+            log_message("Error fetching truncated column: " + std::string(mysql_stmt_error(stmt)), "ERROR");
+            return false;
+        }
+        if (columns[4].is_null) {
+            mod.category = "Общее";
+        }
+        timer.finish(true, 1);
+
+        // Get the media links
+        if (!loadMediaLinks(conn, mod)) {
+            return false;
         }
+        found = std::move(mod);
+        return true;
     }
-    
-    mysql_free_result(result);
-    return mod;
-} 
\ No newline at end of file
+
+    return false;
+}
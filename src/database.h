@@ -4,46 +4,109 @@
 #include <string>
 #include <vector>
 #include <optional>
+#include <functional>
+#include <memory>
+#include <atomic>
 #include <mysql.h>
-#include <chrono>
-#include <mutex>
+#include "mod_storage.h"
+#include "connection_pool.h"
 #include "logger.h"
 
-struct ModData {
-    int id;
-    std::string name;
-    std::string description;
-    std::string link;
-    std::vector<std::string> media_links;
-    std::string category;
-};
-
-class Database {
+// Хранилище модов в MySQL.
+// Инкрементальное обновление требует в схеме столбец mods.updated_at (обновляется
+// при любом изменении мода или его медиа) и таблицу mod_tombstones(mod_id, deleted_at).
+// Счётчики популярности - столбцы mods.downloads и mods.views (BIGINT UNSIGNED NOT NULL DEFAULT 0);
+// их изменение updated_at не трогает.
+class Database : public ModStorage {
 public:
-    Database(const std::string& host, const std::string& user, 
-             const std::string& password, const std::string& db_name);
-    ~Database();
+    // Где выполнять чтение: на репликах (с откатом на основной сервер) или только на основном
+    enum class ReadRoute { Replica, Primary };
+
+    explicit Database(const PoolOptions& primary, const std::vector<PoolOptions>& replicas = {});
+    ~Database() override;
 
+    bool connect() override { return connectToDatabase(); }
     bool connectToDatabase();
-    bool reconnect();
     bool ping();
-    std::vector<ModData> getAllMods();
-    std::optional<ModData> getModById(int mod_id);
+    // Фоновая проверка реплик: недоступные исключаются из балансировки,
+    // восстановившиеся возвращаются после нескольких успешных проверок подряд
+    void checkReplicas();
+    // Фоновое обслуживание пулов: ping простаивающих соединений и предварительное
+    // открытие недостающих, чтобы запросы клиентов не платили за них
+    void maintain() override;
+
+    // Потоковое чтение каталога (mysql_use_result), весь результат в памяти клиента не копится.
+    // Занимает два соединения пула. Читает с основного сервера, чтобы отметка времени
+    // обновления снимка и данные совпадали
+    bool streamAllMods(const ModConsumer& consume) override;
+    bool getModById(int mod_id, std::optional<ModData>& found) override;
+    // Один запрос WHERE id IN (...) и один запрос медиа на весь список
+    bool getModsByIds(const std::vector<int>& mod_ids, std::vector<ModData>& found) override;
+
+    // Текущее время сервера БД
+    std::optional<std::string> getServerTime() override;
+    std::optional<ModChanges> getModChanges(const std::string& since) override;
+    // Пакет записей одной транзакцией на основном сервере: моды пишутся многострочными
+    // INSERT ... ON DUPLICATE KEY UPDATE, медиа и надгробия - многострочными INSERT.
+    // Если сервер отверг пакет целиком, записи применяются по одной
+    bool applyWrites(const std::vector<ModWrite>& writes, std::vector<ModWriteResult>& results) override;
+    // Все приращения одной транзакцией: UPDATE ... SET downloads = downloads + CASE id ... END
+    // пачками по COUNTER_CHUNK модов
+    CounterWriteStatus addCounters(const std::vector<ModCounterDelta>& deltas) override;
 
 private:
+    struct Replica {
+        std::string host;
+        std::unique_ptr<ConnectionPool> pool;
+        std::atomic<int> outstanding{0};  // запросы, выполняющиеся на реплике сейчас
+        std::atomic<bool> healthy{false};
+        int failures = 0;                 // подряд неудачных проверок (только в checkReplicas)
+        int successes = 0;                // подряд успешных проверок (только в checkReplicas)
+    };
+
+    // Выбранный для чтения пул; пока объект жив, запрос учитывается в outstanding реплики
+    class ReadTarget {
+    public:
+        ReadTarget(ConnectionPool& pool, Replica* replica);
+        ReadTarget(ReadTarget&& other) noexcept;
+        ReadTarget(const ReadTarget&) = delete;
+        ReadTarget& operator=(const ReadTarget&) = delete;
+        ReadTarget& operator=(ReadTarget&&) = delete;
+        ~ReadTarget();
+
+        ConnectionPool& pool() const { return *pool_; }
+        bool isReplica() const { return replica_ != nullptr; }
+        // Реплика не выдала соединение - исключаем её до следующей успешной проверки
+        void eject();
+
+    private:
+        ConnectionPool* pool_;
+        Replica* replica_;
+    };
+
+    // Здоровая реплика с наименьшим числом запросов в работе, иначе основной сервер
+    ReadTarget pickReader(ReadRoute route);
+
     void processMySQLResult(MYSQL_RES* result, std::vector<ModData>& mods);
-    bool checkConnection();
-    
-    MYSQL* mysql;
-    std::string host;
-    std::string user;
-    std::string password;
-    std::string db_name;
-    std::chrono::steady_clock::time_point last_ping;
-    static constexpr auto PING_INTERVAL = std::chrono::seconds(60);
-    
-    // Заменяем обычный мьютекс на рекурсивный мьютекс
-    std::recursive_mutex db_mutex;
+    static ModData parseModRow(MYSQL_ROW row);
+    bool loadMediaLinks(MYSQL* mysql, std::vector<ModData>& mods, const std::string& filter = "");
+    bool querySingleValue(MYSQL* mysql, const std::string& query, std::string& value);
+    bool loadMediaLinks(ConnectionPool::Handle& conn, ModData& mod);
+    // Транзакция записи; committing = true, если ошибка случилась уже на COMMIT
+    bool runWriteTransaction(MYSQL* mysql, const std::vector<ModWrite>& writes,
+                             std::vector<ModWriteResult>& results, bool& committing);
+    bool applyWritesOneByOne(const std::vector<ModWrite>& writes, std::vector<ModWriteResult>& results);
+    bool execute(MYSQL* mysql, const std::string& query);
+    static bool isConnectionLost(unsigned int err);
+
+    // Каждый запрос берёт собственное соединение из пула,
+    // поэтому общий мьютекс на всю базу больше не нужен
+    ConnectionPool pool;
+    std::vector<std::unique_ptr<Replica>> replicas;
+
+    static constexpr int EJECT_AFTER_FAILURES = 2;
+    static constexpr int READMIT_AFTER_SUCCESSES = 2;
+    static constexpr std::size_t COUNTER_CHUNK = 1000;
 };
 
 #endif // DATABASE_H 
\ No newline at end of file
@@ -0,0 +1,81 @@
+#include "db_executor.h"
+#include "logger.h"
+#include <exception>
+#include <utility>
+
+DbExecutor::DbExecutor(std::size_t thread_count, std::size_t queue_limit)
+    : queue_limit_(queue_limit) {
+    if (thread_count == 0) {
+        thread_count = 1;
+    }
+    workers_.reserve(thread_count);
+    for (std::size_t i = 0; i < thread_count; ++i) {
+        workers_.emplace_back([this]() { worker_loop(); });
+    }
+    log_message("DB executor started with " + std::to_string(thread_count) +
+                " thread(s), queue limit " + std::to_string(queue_limit_), "INFO");
+}
+
+DbExecutor::~DbExecutor() {
+    stop();
+}
+
+bool DbExecutor::post(std::function<void()> task) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (stopped_) {
+            return false;
+        }
+        if (queue_.size() >= queue_limit_) {
+            log_message("DB executor queue is full (" + std::to_string(queue_.size()) + " tasks)", "WARNING");
+            return false;
+        }
+        queue_.push_back(std::move(task));
+    }
+    has_work_.notify_one();
+    return true;
+}
+
+void DbExecutor::stop() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (stopped_ && workers_.empty()) {
+            return;
+        }
+        stopped_ = true;
+    }
+    has_work_.notify_all();
+
+    for (auto& worker : workers_) {
+        if (worker.joinable()) {
+            worker.join();
+        }
+    }
+    workers_.clear();
+}
+
+std::size_t DbExecutor::pending() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return queue_.size();
+}
+
+void DbExecutor::worker_loop() {
+    while (true) {
+        std::function<void()> task;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            has_work_.wait(lock, [this]() { return stopped_ || !queue_.empty(); });
+            if (queue_.empty()) {
+                return;
+            }
+            task = std::move(queue_.front());
+            queue_.pop_front();
+        }
+
+        try {
+            task();
+        } catch (const std::exception& e) {
+            log_message("DB executor task error: " + std::string(e.what()), "ERROR");
+        }
+    }
+}
@@ -0,0 +1,42 @@
+#ifndef DB_EXECUTOR_H
+#define DB_EXECUTOR_H
+
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <vector>
+
+// Отдельный пул потоков для блокирующей работы с базой данных.
+// Потоки io_context только ставят задачи в очередь и никогда не ждут MySQL.
+class DbExecutor {
+public:
+    DbExecutor(std::size_t thread_count, std::size_t queue_limit);
+    ~DbExecutor();
+
+    DbExecutor(const DbExecutor&) = delete;
+    DbExecutor& operator=(const DbExecutor&) = delete;
+
+    // Ставит задачу в очередь. Возвращает false, если очередь переполнена
+    // или пул уже остановлен - вызывающий должен сразу ответить клиенту ошибкой
+    bool post(std::function<void()> task);
+
+    // Останавливает потоки, дождавшись выполнения уже поставленных задач
+    void stop();
+
+    std::size_t pending() const;
+
+private:
+    void worker_loop();
+
+    const std::size_t queue_limit_;
+    mutable std::mutex mutex_;
+    std::condition_variable has_work_;
+    std::deque<std::function<void()>> queue_;
+    std::vector<std::thread> workers_;
+    bool stopped_ = false;
+};
+
+#endif // DB_EXECUTOR_H
@@ -2,9 +2,19 @@
 #include <boost/asio.hpp>
 #include <thread>
 #include <vector>
+#include <memory>
 #include "server.h"
+#ifdef MODSERVER_WITH_MYSQL
 #include "database.h"
+#endif
+#ifdef MODSERVER_WITH_ASYNC_MYSQL
+#include "async_mysql_client.h"
+#endif
+#include "synthetic_storage.h"
+#include "db_executor.h"
+#include "mod_service.h"
 #include "logger.h"
+#include "query_stats.h"
 #include <boost/asio/signal_set.hpp>
 #include <fstream>
 #include <nlohmann/json.hpp>
@@ -12,6 +22,13 @@
 // Используем библиотеку nlohmann/json
 using json = nlohmann::json;
 
+// Останавливает пул БД раньше, чем разрушаются объекты, на которые ссылаются его задачи,
+// в том числе когда main выходит по исключению
+struct DbExecutorStopper {
+    DbExecutor& executor;
+    ~DbExecutorStopper() { executor.stop(); }
+};
+
 // Функция для вывода заголовка программы
 void print_banner() {
     std::cout << "=================================================" << std::endl;
@@ -39,10 +56,149 @@ int main(int argc, char* argv[]) {
         // Получаем параметры из конфигурации
         const int port = config["server"]["port"];
         const int thread_count = config["server"]["thread_count"];
-        std::string db_host = config["database"]["host"];
-        std::string db_user = config["database"]["user"];
-        std::string db_password = config["database"]["password"];
-        std::string db_name = config["database"]["dbname"];
+        // Хранилище: MySQL или синтетический каталог в памяти для нагрузочных тестов
+        std::string storage_backend = "mysql";
+        SyntheticStorageOptions synthetic_options;
+        if (config.contains("storage")) {
+            const auto& storage_config = config["storage"];
+            storage_backend = storage_config.value("backend", storage_backend);
+            if (storage_config.contains("synthetic")) {
+                const auto& synthetic_config = storage_config["synthetic"];
+                synthetic_options.mod_count = synthetic_config.value("mod_count", synthetic_options.mod_count);
+                synthetic_options.description_bytes =
+                    synthetic_config.value("description_bytes", synthetic_options.description_bytes);
+                synthetic_options.media_per_mod = synthetic_config.value("media_per_mod", synthetic_options.media_per_mod);
+                synthetic_options.seed = synthetic_config.value("seed", synthetic_options.seed);
+                synthetic_options.latency = std::chrono::microseconds(
+                    synthetic_config.value("latency_us", static_cast<long long>(synthetic_options.latency.count())));
+                synthetic_options.churn_per_refresh =
+                    synthetic_config.value("churn_per_refresh", synthetic_options.churn_per_refresh);
+            }
+        }
+
+        std::size_t db_worker_threads = 8;
+        std::size_t db_queue_limit = 1024;
+        int health_check_sec = 5;
+#ifdef MODSERVER_WITH_MYSQL
+        PoolOptions pool_options;
+        // Реплики для чтения: по умолчанию с теми же учётными данными и размерами пула
+        std::vector<PoolOptions> replica_options;
+        // Неблокирующий клиент для GET_MOD_BY_ID, работающий прямо в io_context
+        bool async_lookups = false;
+#ifdef MODSERVER_WITH_ASYNC_MYSQL
+        AsyncClientOptions async_options;
+#endif
+        if (storage_backend == "mysql") {
+            pool_options.host = config["database"]["host"];
+            pool_options.user = config["database"]["user"];
+            pool_options.password = config["database"]["password"];
+            pool_options.db_name = config["database"]["dbname"];
+            db_worker_threads = pool_options.max_size;
+
+            if (config["database"].contains("pool")) {
+                const auto& pool_config = config["database"]["pool"];
+                pool_options.min_size = pool_config.value("min_size", pool_options.min_size);
+                pool_options.max_size = pool_config.value("max_size", pool_options.max_size);
+                pool_options.checkout_timeout = std::chrono::milliseconds(
+                    pool_config.value("checkout_timeout_ms", static_cast<int>(pool_options.checkout_timeout.count())));
+                pool_options.keepalive_interval = std::chrono::seconds(
+                    pool_config.value("keepalive_sec", static_cast<int>(pool_options.keepalive_interval.count())));
+                db_worker_threads = pool_options.max_size;
+            }
+            if (config["database"].contains("replicas")) {
+                for (const auto& replica_config : config["database"]["replicas"]) {
+                    PoolOptions replica = pool_options;
+                    replica.host = replica_config.value("host", replica.host);
+                    replica.user = replica_config.value("user", replica.user);
+                    replica.password = replica_config.value("password", replica.password);
+                    replica.db_name = replica_config.value("dbname", replica.db_name);
+                    replica_options.push_back(replica);
+                }
+            }
+            if (config["database"].contains("async_client")) {
+                const auto& async_config = config["database"]["async_client"];
+                async_lookups = async_config.value("enabled", async_lookups);
+#ifdef MODSERVER_WITH_ASYNC_MYSQL
+                async_options.connections = async_config.value("connections", async_options.connections);
+                async_options.queue_limit = async_config.value("queue_limit", async_options.queue_limit);
+                async_options.query_timeout = std::chrono::milliseconds(
+                    async_config.value("query_timeout_ms", static_cast<int>(async_options.query_timeout.count())));
+#else
+                if (async_lookups) {
+                    log_message("Клиентская библиотека MySQL без неблокирующего API, async_client отключён: "
+                                "поиск по id идёт через пул БД", "WARNING");
+                    async_lookups = false;
+                }
+#endif
+            }
+        }
+#endif
+        if (config.contains("database")) {
+            db_worker_threads = config["database"].value("worker_threads", db_worker_threads);
+            db_queue_limit = config["database"].value("queue_limit", db_queue_limit);
+            health_check_sec = config["database"].value("health_check_interval_sec", health_check_sec);
+        }
+
+        ModCacheOptions cache_options;
+        if (config.contains("cache")) {
+            const auto& cache_config = config["cache"];
+            cache_options.shards = cache_config.value("shards", cache_options.shards);
+            cache_options.max_bytes = cache_config.value("max_mb", cache_options.max_bytes / (1024 * 1024)) * 1024 * 1024;
+            cache_options.ttl = std::chrono::seconds(cache_config.value("ttl_sec", static_cast<int>(cache_options.ttl.count())));
+            cache_options.negative_ttl = std::chrono::seconds(
+                cache_config.value("negative_ttl_sec", static_cast<int>(cache_options.negative_ttl.count())));
+        }
+
+        CircuitBreakerOptions breaker_options;
+        if (config.contains("circuit_breaker")) {
+            const auto& breaker_config = config["circuit_breaker"];
+            breaker_options.failure_threshold = breaker_config.value("failure_threshold", breaker_options.failure_threshold);
+            breaker_options.open_duration = std::chrono::milliseconds(
+                breaker_config.value("open_ms", static_cast<int>(breaker_options.open_duration.count())));
+            breaker_options.half_open_probes = breaker_config.value("half_open_probes", breaker_options.half_open_probes);
+        }
+
+        LookupBatchOptions batch_options;
+        if (config.contains("lookup_batching")) {
+            const auto& batch_config = config["lookup_batching"];
+            batch_options.window = std::chrono::microseconds(
+                batch_config.value("window_us", static_cast<long long>(batch_options.window.count())));
+            batch_options.max_keys = batch_config.value("max_keys", batch_options.max_keys);
+        }
+
+        WriteBatchOptions write_options;
+        if (config.contains("writes")) {
+            const auto& write_config = config["writes"];
+            write_options.enabled = write_config.value("enabled", write_options.enabled);
+            write_options.max_batch = write_config.value("max_batch", write_options.max_batch);
+            write_options.queue_limit = write_config.value("queue_limit", write_options.queue_limit);
+        }
+
+        int counter_flush_ms = 5000;
+        if (config.contains("counters")) {
+            counter_flush_ms = config["counters"].value("flush_interval_ms", counter_flush_ms);
+        }
+
+        QueryStatsOptions stats_options;
+        if (config.contains("db_stats")) {
+            const auto& stats_config = config["db_stats"];
+            stats_options.slow_threshold = std::chrono::milliseconds(
+                stats_config.value("slow_query_ms", static_cast<int>(stats_options.slow_threshold.count())));
+            stats_options.slow_log_size = stats_config.value("slow_log_size", stats_options.slow_log_size);
+        }
+        query_stats().configure(stats_options);
+
+        int catalog_refresh_sec = 30;
+        int catalog_full_refresh_every = 60;
+        // Файл снимка каталога для быстрого старта; пустой путь отключает сохранение
+        std::string catalog_snapshot_file;
+        int catalog_snapshot_sec = 60;
+        if (config.contains("catalog")) {
+            catalog_refresh_sec = config["catalog"].value("refresh_interval_sec", catalog_refresh_sec);
+            catalog_full_refresh_every = config["catalog"].value("full_refresh_every", catalog_full_refresh_every);
+            catalog_snapshot_file = config["catalog"].value("snapshot_file", catalog_snapshot_file);
+            catalog_snapshot_sec = config["catalog"].value("snapshot_interval_sec", catalog_snapshot_sec);
+        }
 
         std::cout << "=================================================" << std::endl;
         std::cout << "      Paradise Mod Server - версия 1.0.0" << std::endl;
@@ -52,7 +208,25 @@ int main(int argc, char* argv[]) {
         std::cout << "Параметры запуска:" << std::endl;
         std::cout << "- Порт: " << port << std::endl;
         std::cout << "- Количество рабочих потоков: " << thread_count << std::endl;
-        std::cout << "- MySQL соединение: " << db_host << ", БД: " << db_name << std::endl;
+        std::cout << "- Хранилище: " << storage_backend << std::endl;
+#ifdef MODSERVER_WITH_MYSQL
+        if (storage_backend == "mysql") {
+            std::cout << "- MySQL соединение: " << pool_options.host << ", БД: " << pool_options.db_name << std::endl;
+            std::cout << "- Реплик для чтения: " << replica_options.size() << std::endl;
+            std::cout << "- Пул соединений: " << pool_options.min_size << "-" << pool_options.max_size << std::endl;
+#ifdef MODSERVER_WITH_ASYNC_MYSQL
+            if (async_lookups) {
+                std::cout << "- Неблокирующих соединений для поиска по id: " << async_options.connections << std::endl;
+            }
+#endif
+        }
+#endif
+        if (storage_backend == "synthetic") {
+            std::cout << "- Синтетический каталог: " << synthetic_options.mod_count << " модов, описание ~"
+                      << synthetic_options.description_bytes << " байт, медиа на мод: "
+                      << synthetic_options.media_per_mod << std::endl;
+        }
+        std::cout << "- Потоков БД: " << db_worker_threads << ", очередь: " << db_queue_limit << std::endl;
 
         boost::asio::io_context io_context;
 
@@ -70,16 +244,72 @@ int main(int argc, char* argv[]) {
                 io_context.stop();
             });
 
-        std::cout << "Подключение к базе данных..." << std::endl;
-        Database db(db_host, db_user, db_password, db_name);
-        if (!db.connectToDatabase()) {
-            log_message("Failed to connect to database. Exiting...", "ERROR");
+        std::unique_ptr<ModStorage> storage;
+        if (storage_backend == "synthetic") {
+            storage = std::make_unique<SyntheticStorage>(synthetic_options);
+        }
+#ifdef MODSERVER_WITH_MYSQL
+        else if (storage_backend == "mysql") {
+            storage = std::make_unique<Database>(pool_options, replica_options);
+        }
+#endif
+        if (!storage) {
+            log_message("Unsupported storage backend: " + storage_backend + ". Exiting...", "ERROR");
             return 1;
         }
-        std::cout << "√ Успешное подключение к базе данных" << std::endl;
+
+        // Блокирующие запросы к БД выполняются в отдельном пуле, а не в потоках io_context
+        DbExecutor db_executor(db_worker_threads, db_queue_limit);
+        ModService service(io_context, *storage, db_executor, cache_options, breaker_options, batch_options,
+                           write_options);
+        // Объявлен после service, поэтому разрушается раньше него
+        DbExecutorStopper executor_stopper{db_executor};
+
+        // С каталогом из файла сервер начинает отвечать сразу, а подключение к БД и полная
+        // загрузка идут в фоне. Без файла, как и раньше, без БД не стартуем
+        bool warm_start = !catalog_snapshot_file.empty() && service.loadCatalogFile(catalog_snapshot_file);
+        if (warm_start) {
+            std::cout << "√ Каталог загружен из файла " << catalog_snapshot_file
+                      << ", подключение к хранилищу в фоне" << std::endl;
+            db_executor.post([&storage, &service]() {
+                if (!storage->connect()) {
+                    log_message("Failed to connect to database, serving catalog from file", "WARNING");
+                }
+                if (!service.refreshCatalog()) {
+                    log_message("Не удалось загрузить каталог из базы, отдаём каталог из файла до следующего обновления",
+                                "WARNING");
+                }
+            });
+        } else {
+            std::cout << "Подключение к хранилищу..." << std::endl;
+            if (!storage->connect()) {
+                log_message("Failed to connect to database. Exiting...", "ERROR");
+                return 1;
+            }
+            std::cout << "√ Успешное подключение к хранилищу" << std::endl;
+        }
+#ifdef MODSERVER_WITH_ASYNC_MYSQL
+        std::unique_ptr<AsyncMySqlClient> async_client;
+        if (storage_backend == "mysql" && async_lookups) {
+            async_client = std::make_unique<AsyncMySqlClient>(io_context, pool_options, async_options);
+            async_client->start();
+            service.setAsyncSource(async_client.get());
+        }
+#endif
+
+        // Первый снимок каталога загружаем до приёма соединений
+        if (!warm_start && !service.refreshCatalog()) {
+            log_message("Не удалось загрузить каталог, GET_ALL_MODS будет читать из базы до первого обновления", "WARNING");
+        }
+        service.startCatalogRefresh(std::chrono::seconds(catalog_refresh_sec), catalog_full_refresh_every);
+        service.startMaintenance(std::chrono::seconds(health_check_sec));
+        service.startCounterFlush(std::chrono::milliseconds(counter_flush_ms));
+        if (!catalog_snapshot_file.empty()) {
+            service.startCatalogPersistence(catalog_snapshot_file, std::chrono::seconds(catalog_snapshot_sec));
+        }
 
         std::cout << "Запуск сервера на порту " << port << "..." << std::endl;
-        Server server(io_context, port, db);
+        Server server(io_context, port, service);
         
         std::cout << "√ Сервер запущен и готов принимать соединения" << std::endl;
         std::cout << "=================================================" << std::endl;
@@ -110,6 +340,15 @@ int main(int argc, char* argv[]) {
             }
         }
 
+        // Пул БД останавливаем, пока service и storage живы: его задачи держат указатели на них.
+        // stop() дожидается уже поставленных задач, после него в пуле ничего не выполняется
+        db_executor.stop();
+
+        // Несохранённые счётчики уходят в БД до выхода, прямо в этом потоке, а не через пул
+        service.flushCounters();
+        // Следующий запуск поднимет каталог из файла, не дожидаясь БД
+        service.saveCatalogFile();
+
         log_message("Сервер успешно остановлен", "INFO");
         return 0;
     }
@@ -0,0 +1,144 @@
+#include "mod_cache.h"
+#include <algorithm>
+
+ModCache::ModCache(const ModCacheOptions& options)
+    : options_(options) {
+    if (options_.shards == 0) {
+        options_.shards = 1;
+    }
+    shard_budget_ = std::max<std::size_t>(options_.max_bytes / options_.shards, 1);
+    shards_.reserve(options_.shards);
+    for (std::size_t i = 0; i < options_.shards; ++i) {
+        shards_.push_back(std::make_unique<Shard>());
+    }
+}
+
+ModCache::Shard& ModCache::shardFor(int mod_id) {
+    auto key = static_cast<std::size_t>(static_cast<unsigned int>(mod_id));
+    return *shards_[key % shards_.size()];
+}
+
+std::size_t ModCache::estimateBytes(const ModData* mod) {
+    // Накладные расходы узла списка и хэш-таблицы
+    std::size_t bytes = sizeof(Node) + 64;
+    if (mod) {
+        bytes += sizeof(ModData) + mod->name.capacity() + mod->description.capacity() +
+                 mod->link.capacity() + mod->category.capacity();
+        for (const auto& media : mod->media_links) {
+            bytes += sizeof(std::string) + media.capacity();
+        }
+    }
+    return bytes;
+}
+
+void ModCache::erase(Shard& shard, std::list<Node>::iterator it) {
+    shard.bytes -= it->bytes;
+    shard.index.erase(it->id);
+    shard.lru.erase(it);
+}
+
+std::optional<ModCache::Hit> ModCache::get(int mod_id) {
+    Shard& shard = shardFor(mod_id);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+
+    auto found = shard.index.find(mod_id);
+    if (found == shard.index.end()) {
+        return std::nullopt;
+    }
+
+    auto it = found->second;
+    if (it->expires <= Clock::now()) {
+        // Устаревшее "мода нет" бесполезно даже как запасной ответ
+        if (!it->mod) {
+            erase(shard, it);
+            return std::nullopt;
+        }
+        return Hit{it->mod, true};
+    }
+
+    shard.lru.splice(shard.lru.begin(), shard.lru, it);
+    return Hit{it->mod, false};
+}
+
+void ModCache::put(int mod_id, const std::optional<ModData>& mod, std::uint64_t generation) {
+    Value value = mod ? std::make_shared<const ModData>(*mod) : nullptr;
+    std::size_t bytes = estimateBytes(value.get());
+    if (bytes > shard_budget_) {
+        return;
+    }
+    auto expires = Clock::now() + (value ? options_.ttl : options_.negative_ttl);
+
+    Shard& shard = shardFor(mod_id);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    if (generation != generation_.load()) {
+        return;
+    }
+
+    auto found = shard.index.find(mod_id);
+    if (found != shard.index.end()) {
+        erase(shard, found->second);
+    }
+
+    shard.lru.push_front(Node{mod_id, std::move(value), expires, bytes});
+    shard.index[mod_id] = shard.lru.begin();
+    shard.bytes += bytes;
+
+    // Вытесняем давно не использованные записи, пока не уложимся в бюджет шарда
+    while (shard.bytes > shard_budget_ && !shard.lru.empty()) {
+        erase(shard, std::prev(shard.lru.end()));
+    }
+}
+
+void ModCache::addCounters(const std::vector<ModCounterDelta>& deltas) {
+    for (const auto& delta : deltas) {
+        Shard& shard = shardFor(delta.mod_id);
+        std::lock_guard<std::mutex> lock(shard.mutex);
+
+        auto found = shard.index.find(delta.mod_id);
+        if (found == shard.index.end() || !found->second->mod) {
+            continue;
+        }
+        // Значения неизменяемы и могут быть у читателей, поэтому подменяем копией.
+        // Размер строк не меняется, учёт памяти шарда остаётся верным
+        auto mod = std::make_shared<ModData>(*found->second->mod);
+        mod->downloads += delta.downloads;
+        mod->views += delta.views;
+        found->second->mod = std::move(mod);
+    }
+}
+
+void ModCache::invalidate(int mod_id) {
+    Shard& shard = shardFor(mod_id);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    ++generation_;
+
+    auto found = shard.index.find(mod_id);
+    if (found != shard.index.end()) {
+        erase(shard, found->second);
+    }
+}
+
+void ModCache::invalidate(const std::vector<int>& mod_ids) {
+    for (int mod_id : mod_ids) {
+        invalidate(mod_id);
+    }
+}
+
+void ModCache::clear() {
+    ++generation_;
+    for (auto& shard : shards_) {
+        std::lock_guard<std::mutex> lock(shard->mutex);
+        shard->lru.clear();
+        shard->index.clear();
+        shard->bytes = 0;
+    }
+}
+
+std::size_t ModCache::bytes() const {
+    std::size_t total = 0;
+    for (const auto& shard : shards_) {
+        std::lock_guard<std::mutex> lock(shard->mutex);
+        total += shard->bytes;
+    }
+    return total;
+}
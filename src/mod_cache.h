@@ -0,0 +1,86 @@
+#ifndef MOD_CACHE_H
+#define MOD_CACHE_H
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <unordered_map>
+#include <vector>
+#include "mod_storage.h"
+
+struct ModCacheOptions {
+    std::size_t shards = 16;
+    std::size_t max_bytes = 64 * 1024 * 1024;
+    std::chrono::seconds ttl{300};
+    // Отрицательные записи ("мода нет") живут недолго, чтобы новые моды появлялись быстро
+    std::chrono::seconds negative_ttl{10};
+};
+
+// Кэш GET_MOD_BY_ID перед базой данных. Разбит на шарды со своими мьютексами,
+// в каждом шарде - LRU-список с ограничением по памяти и TTL на запись.
+class ModCache {
+public:
+    using Clock = std::chrono::steady_clock;
+    using Value = std::shared_ptr<const ModData>;
+
+    struct Hit {
+        Value mod;     // nullptr - мод точно отсутствует (отрицательная запись)
+        bool expired;  // TTL истёк: значение годится только как устаревшее при недоступной БД
+    };
+
+    explicit ModCache(const ModCacheOptions& options);
+
+    // nullopt - промах. Просроченные положительные записи не удаляются сразу,
+    // а возвращаются с expired = true, пока их не вытеснит LRU
+    std::optional<Hit> get(int mod_id);
+
+    // Номер поколения: меняется при каждой инвалидации. Его запоминают перед запросом к БД
+    std::uint64_t generation() const { return generation_.load(); }
+
+    // Сохраняет результат успешного запроса к БД; nullopt кэшируется как отсутствие мода.
+    // Если с начала запроса (generation) была инвалидация, результат мог устареть и не сохраняется
+    void put(int mod_id, const std::optional<ModData>& mod, std::uint64_t generation);
+
+    // Прибавляет сохранённые в БД приращения счётчиков к закэшированным модам на месте.
+    // Поколение не меняется и позиция в LRU не трогается: горячие моды остаются в кэше,
+    // а идущие загрузки не отбрасываются
+    void addCounters(const std::vector<ModCounterDelta>& deltas);
+
+    // Хуки инвалидации: вызываются, когда мод изменился или удалён
+    void invalidate(int mod_id);
+    void invalidate(const std::vector<int>& mod_ids);
+    void clear();
+
+    std::size_t bytes() const;
+
+private:
+    struct Node {
+        int id;
+        Value mod;
+        Clock::time_point expires;
+        std::size_t bytes;
+    };
+
+    struct Shard {
+        mutable std::mutex mutex;
+        std::list<Node> lru; // начало списка - самые свежие обращения
+        std::unordered_map<int, std::list<Node>::iterator> index;
+        std::size_t bytes = 0;
+    };
+
+    Shard& shardFor(int mod_id);
+    static void erase(Shard& shard, std::list<Node>::iterator it);
+    static std::size_t estimateBytes(const ModData* mod);
+
+    ModCacheOptions options_;
+    std::size_t shard_budget_;
+    std::vector<std::unique_ptr<Shard>> shards_;
+    std::atomic<std::uint64_t> generation_{0};
+};
+
+#endif // MOD_CACHE_H
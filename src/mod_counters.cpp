@@ -0,0 +1,69 @@
+#include "mod_counters.h"
+#include <algorithm>
+#include <functional>
+#include <thread>
+
+ModCounters::ModCounters(std::size_t shards) : shard_count_(shards) {
+    if (shard_count_ == 0) {
+        shard_count_ = std::max(1u, std::thread::hardware_concurrency());
+    }
+    shards_.reset(new Shard[shard_count_]);
+}
+
+ModCounters::Shard& ModCounters::localShard() {
+    // Номер шарда вычисляется один раз на поток
+    thread_local std::size_t hash = std::hash<std::thread::id>{}(std::this_thread::get_id());
+    return shards_[hash % shard_count_];
+}
+
+void ModCounters::add(int mod_id, Kind kind, std::uint64_t count) {
+    Shard& shard = localShard();
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    auto& delta = shard.deltas[mod_id];
+    delta.mod_id = mod_id;
+    if (kind == Kind::Download) {
+        delta.downloads += count;
+    } else {
+        delta.views += count;
+    }
+}
+
+std::vector<ModCounterDelta> ModCounters::drain() {
+    std::unordered_map<int, ModCounterDelta> merged;
+    for (std::size_t i = 0; i < shard_count_; ++i) {
+        std::unordered_map<int, ModCounterDelta> taken;
+        {
+            // Под мьютексом только обмен таблиц, слияние идёт без блокировки
+            std::lock_guard<std::mutex> lock(shards_[i].mutex);
+            taken.swap(shards_[i].deltas);
+        }
+        if (merged.empty()) {
+            merged.swap(taken);
+            continue;
+        }
+        for (const auto& entry : taken) {
+            auto& delta = merged[entry.first];
+            delta.mod_id = entry.first;
+            delta.downloads += entry.second.downloads;
+            delta.views += entry.second.views;
+        }
+    }
+
+    std::vector<ModCounterDelta> deltas;
+    deltas.reserve(merged.size());
+    for (const auto& entry : merged) {
+        deltas.push_back(entry.second);
+    }
+    return deltas;
+}
+
+void ModCounters::restore(const std::vector<ModCounterDelta>& deltas) {
+    Shard& shard = localShard();
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    for (const auto& restored : deltas) {
+        auto& delta = shard.deltas[restored.mod_id];
+        delta.mod_id = restored.mod_id;
+        delta.downloads += restored.downloads;
+        delta.views += restored.views;
+    }
+}
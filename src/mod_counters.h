@@ -0,0 +1,41 @@
+#ifndef MOD_COUNTERS_H
+#define MOD_COUNTERS_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+#include "mod_storage.h"
+
+// Счётчики скачиваний и просмотров, накапливаемые в памяти до сброса в БД (write-behind).
+// Шард выбирается по потоку, поэтому потоки io_context почти не делят мьютексы,
+// а одна горячая строка не становится точкой конкуренции ни в памяти, ни в MySQL
+class ModCounters {
+public:
+    enum class Kind { Download, View };
+
+    // shards = 0 - по числу ядер
+    explicit ModCounters(std::size_t shards = 0);
+
+    void add(int mod_id, Kind kind, std::uint64_t count = 1);
+    // Забирает накопленные приращения, суммированные по модам, и обнуляет счётчики
+    std::vector<ModCounterDelta> drain();
+    // Возвращает приращения, которые не удалось сохранить, чтобы они ушли со следующим сбросом
+    void restore(const std::vector<ModCounterDelta>& deltas);
+
+private:
+    // Выравнивание по кэш-линии: соседние шарды не делят её между ядрами
+    struct alignas(64) Shard {
+        std::mutex mutex;
+        std::unordered_map<int, ModCounterDelta> deltas;
+    };
+
+    Shard& localShard();
+
+    std::size_t shard_count_;
+    std::unique_ptr<Shard[]> shards_;
+};
+
+#endif // MOD_COUNTERS_H
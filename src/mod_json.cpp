@@ -0,0 +1,47 @@
+#include "mod_json.h"
+#include <sstream>
+
+std::optional<FieldMask> parse_field_list(const std::string& list) {
+    static const std::pair<const char*, ModField> FIELD_NAMES[] = {
+        {"id", FIELD_ID}, {"name", FIELD_NAME}, {"description", FIELD_DESCRIPTION}, {"link", FIELD_LINK},
+        {"media", FIELD_MEDIA}, {"category", FIELD_CATEGORY}, {"preview", FIELD_PREVIEW},
+        {"downloads", FIELD_DOWNLOADS}, {"views", FIELD_VIEWS}
+    };
+
+    FieldMask mask = FIELD_ID;
+    std::istringstream fields(list);
+    std::string field;
+    while (std::getline(fields, field, ',')) {
+        if (field.empty()) {
+            continue;
+        }
+        bool known = false;
+        for (const auto& entry : FIELD_NAMES) {
+            if (field == entry.first) {
+                mask |= entry.second;
+                known = true;
+                break;
+            }
+        }
+        if (!known) {
+            return std::nullopt;
+        }
+    }
+    return mask;
+}
+
+nlohmann::json mod_to_json(const ModData& mod, FieldMask fields) {
+    nlohmann::json json = nlohmann::json::object();
+    if (fields & FIELD_ID) json["id"] = mod.id;
+    if (fields & FIELD_NAME) json["name"] = mod.name;
+    if (fields & FIELD_DESCRIPTION) json["description"] = mod.description;
+    if (fields & FIELD_LINK) json["link"] = mod.link;
+    if (fields & FIELD_MEDIA) json["media"] = mod.media_links;
+    if (fields & FIELD_CATEGORY) json["category"] = mod.category;
+    if (fields & FIELD_PREVIEW) {
+        json["preview"] = mod.media_links.empty() ? nlohmann::json(nullptr) : nlohmann::json(mod.media_links.front());
+    }
+    if (fields & FIELD_DOWNLOADS) json["downloads"] = mod.downloads;
+    if (fields & FIELD_VIEWS) json["views"] = mod.views;
+    return json;
+}
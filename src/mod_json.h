@@ -0,0 +1,37 @@
+#ifndef MOD_JSON_H
+#define MOD_JSON_H
+
+#include <nlohmann/json.hpp>
+#include <optional>
+#include <string>
+#include "mod_storage.h"
+
+// Поля мода в ответах; набор полей задаётся битовой маской
+enum ModField : unsigned {
+    FIELD_ID = 1u << 0,
+    FIELD_NAME = 1u << 1,
+    FIELD_DESCRIPTION = 1u << 2,
+    FIELD_LINK = 1u << 3,
+    FIELD_MEDIA = 1u << 4,
+    FIELD_CATEGORY = 1u << 5,
+    // Первая ссылка на медиа - превью для списков, отдельно от полного "media"
+    FIELD_PREVIEW = 1u << 6,
+    FIELD_DOWNLOADS = 1u << 7,
+    FIELD_VIEWS = 1u << 8
+};
+using FieldMask = unsigned;
+
+// Поля ответа по умолчанию (формат, который был до появления fields=)
+constexpr FieldMask DEFAULT_FIELDS =
+    FIELD_ID | FIELD_NAME | FIELD_DESCRIPTION | FIELD_LINK | FIELD_MEDIA | FIELD_CATEGORY |
+    FIELD_DOWNLOADS | FIELD_VIEWS;
+
+// Разбирает список полей вида "id,name,category,preview".
+// id добавляется всегда: без него клиент не сопоставит ответ с модом.
+// nullopt - в списке есть неизвестное поле
+std::optional<FieldMask> parse_field_list(const std::string& list);
+
+// Единый формат мода в ответах клиенту
+nlohmann::json mod_to_json(const ModData& mod, FieldMask fields = DEFAULT_FIELDS);
+
+#endif // MOD_JSON_H
@@ -0,0 +1,679 @@
+#include "mod_service.h"
+#include "logger.h"
+#include "catalog_file.h"
+#include <unordered_map>
+
+ModService::ModService(boost::asio::io_context& io_context, ModStorage& storage, DbExecutor& executor,
+                       const ModCacheOptions& cache_options, const CircuitBreakerOptions& breaker_options,
+                       const LookupBatchOptions& batch_options, const WriteBatchOptions& write_options)
+    : io_context_(io_context), storage_(storage), executor_(executor), cache_(cache_options), breaker_(breaker_options),
+      batch_options_(batch_options), batch_timer_(io_context), write_options_(write_options),
+      refresh_timer_(io_context), maintenance_timer_(io_context), counter_timer_(io_context),
+      persist_timer_(io_context) {
+    if (batch_options_.max_keys == 0) {
+        batch_options_.max_keys = 1;
+    }
+    if (write_options_.max_batch == 0) {
+        write_options_.max_batch = 1;
+    }
+}
+
+// Ключ единственной загрузки полного каталога
+static constexpr int CATALOG_KEY = 0;
+
+bool ModService::loadCatalog(ReplyExecutor reply_to, SnapshotHandler handler) {
+    return runShared(catalog_flights_, CATALOG_KEY, std::move(reply_to), std::move(handler),
+                     [this]() {
+                         // Если снимок уже грузит фоновое обновление, отдаём то, что есть
+                         refreshCatalog();
+                         return catalog_.current();
+                     });
+}
+
+static ModLookup make_lookup(std::shared_ptr<const ModData> mod) {
+    ModLookup lookup;
+    lookup.status = mod ? ModLookup::Status::Found : ModLookup::Status::NotFound;
+    lookup.mod = std::move(mod);
+    return lookup;
+}
+
+bool ModService::getModById(int mod_id, ReplyExecutor reply_to, ModHandler handler) {
+    auto cached = cache_.get(mod_id);
+    if (cached && !cached->expired) {
+        boost::asio::dispatch(reply_to, [handler = std::move(handler), result = make_lookup(cached->mod)]() {
+            handler(result);
+        });
+        return true;
+    }
+
+    // Цепь разомкнута: не ждём таймаутов MySQL, сразу отвечаем последними известными данными
+    if (!breaker_.allow()) {
+        boost::asio::dispatch(reply_to, [handler = std::move(handler), result = staleLookup(mod_id, cached)]() {
+            handler(result);
+        });
+        return true;
+    }
+
+    // Вердикт для пробы сообщит только запрос, который сам запустил загрузку и поставил её в очередь
+    bool started = false;
+    bool queued = false;
+    if (async_source_) {
+        queued = getModByIdAsync(mod_id, std::move(reply_to), std::move(handler), started);
+    } else if (batch_options_.window.count() > 0) {
+        queued = mod_flights_.join(mod_id, makeWaiter(std::move(reply_to), std::move(handler)),
+                                   [this, mod_id, &started]() {
+                                       started = true;
+                                       return enqueueBatched(mod_id);
+                                   });
+    } else {
+        queued = runShared(mod_flights_, mod_id, std::move(reply_to), std::move(handler),
+                           [this, mod_id]() {
+                               auto generation = cache_.generation();
+                               std::optional<ModData> mod;
+                               bool ok = storage_.getModById(mod_id, mod);
+                               return finishLookup(mod_id, ok, std::move(mod), generation);
+                           }, &started);
+    }
+    if (!queued || !started) {
+        breaker_.cancel();
+    }
+    return queued;
+}
+
+bool ModService::getModByIdAsync(int mod_id, ReplyExecutor reply_to, ModHandler handler, bool& started) {
+    return mod_flights_.join(mod_id, makeWaiter(std::move(reply_to), std::move(handler)), [this, mod_id, &started]() {
+        started = true;
+        auto generation = cache_.generation();
+        // Источник вызывает callback позже из io_context, поэтому complete() не попадёт под мьютекс join()
+        return async_source_->getModById(mod_id, [this, mod_id, generation](bool ok, std::optional<ModData>&& mod) {
+            mod_flights_.complete(mod_id, finishLookup(mod_id, ok, std::move(mod), generation));
+        });
+    });
+}
+
+bool ModService::enqueueBatched(int mod_id) {
+    std::lock_guard<std::mutex> lock(batch_mutex_);
+    batch_ids_.push_back(mod_id);
+
+    if (batch_ids_.size() >= batch_options_.max_keys) {
+        flushBatchLocked();
+        return true;
+    }
+    if (batch_ids_.size() == 1) {
+        // Первый id пакета запускает окно ожидания
+        unsigned long long number = batch_number_;
+        batch_timer_.expires_after(batch_options_.window);
+        batch_timer_.async_wait([this, number](const boost::system::error_code& ec) {
+            if (ec) {
+                return;
+            }
+            std::lock_guard<std::mutex> lock(batch_mutex_);
+            if (number == batch_number_ && !batch_ids_.empty()) {
+                flushBatchLocked();
+            }
+        });
+    }
+    return true;
+}
+
+void ModService::flushBatchLocked() {
+    std::vector<int> mod_ids;
+    mod_ids.swap(batch_ids_);
+    ++batch_number_;
+
+    bool queued = executor_.post([this, mod_ids]() { loadBatch(mod_ids); });
+    if (!queued) {
+        // Каждый id пакета занял пробу автомата, а в БД так и не попал
+        for (std::size_t i = 0; i < mod_ids.size(); ++i) {
+            breaker_.cancel();
+        }
+        // Очередь пула переполнена. Загрузки уже зарегистрированы в single-flight,
+        // поэтому завершаем их запасным ответом, но не отсюда: мы можем быть под его мьютексом
+        boost::asio::post(io_context_, [this, mod_ids]() {
+            auto lookups = staleLookups(mod_ids);
+            for (std::size_t i = 0; i < mod_ids.size(); ++i) {
+                mod_flights_.complete(mod_ids[i], std::move(lookups[i]));
+            }
+        });
+    }
+}
+
+void ModService::loadBatch(const std::vector<int>& mod_ids) {
+    log_message("Batching " + std::to_string(mod_ids.size()) + " mod lookups into one query", "DEBUG");
+    auto lookups = loadMods(mod_ids);
+    for (std::size_t i = 0; i < mod_ids.size(); ++i) {
+        mod_flights_.complete(mod_ids[i], std::move(lookups[i]));
+    }
+}
+
+std::vector<ModLookup> ModService::loadMods(const std::vector<int>& mod_ids) {
+    auto generation = cache_.generation();
+    std::vector<ModData> found;
+    bool ok = false;
+    try {
+        ok = storage_.getModsByIds(mod_ids, found);
+    } catch (const std::exception& e) {
+        log_message("Database task error: " + std::string(e.what()), "ERROR");
+    }
+
+    // Один запрос - один вердикт автомату, сколько бы id в нём ни было
+    if (!ok) {
+        breaker_.recordFailure();
+        return staleLookups(mod_ids);
+    }
+    breaker_.recordSuccess();
+
+    std::unordered_map<int, std::shared_ptr<const ModData>> by_id;
+    by_id.reserve(found.size());
+    for (auto& mod : found) {
+        int mod_id = mod.id;
+        cache_.put(mod_id, mod, generation);
+        by_id.emplace(mod_id, std::make_shared<const ModData>(std::move(mod)));
+    }
+
+    std::vector<ModLookup> lookups;
+    lookups.reserve(mod_ids.size());
+    for (int mod_id : mod_ids) {
+        auto it = by_id.find(mod_id);
+        if (it == by_id.end()) {
+            // Не найденные в хранилище id запоминаем отрицательными записями
+            cache_.put(mod_id, std::nullopt, generation);
+            lookups.push_back(make_lookup(nullptr));
+        } else {
+            lookups.push_back(make_lookup(it->second));
+        }
+    }
+    return lookups;
+}
+
+ModLookup ModService::finishLookup(int mod_id, bool ok, std::optional<ModData>&& mod, std::uint64_t generation) {
+    // Ошибку БД не кэшируем, чтобы не выдать её за отсутствие мода
+    if (!ok) {
+        breaker_.recordFailure();
+        return staleLookup(mod_id, cache_.get(mod_id));
+    }
+    breaker_.recordSuccess();
+    cache_.put(mod_id, mod, generation);
+    return make_lookup(mod ? std::make_shared<const ModData>(std::move(*mod)) : nullptr);
+}
+
+bool ModService::getModsByIds(std::vector<int> mod_ids, ReplyExecutor reply_to, BatchHandler handler) {
+    // Сначала отвечаем всем, что есть в кэше; промахи собираем для одного запроса
+    auto resolved = std::make_shared<std::unordered_map<int, ModLookup>>();
+    std::vector<int> misses;
+    for (int mod_id : mod_ids) {
+        if (resolved->count(mod_id)) {
+            continue;
+        }
+        auto cached = cache_.get(mod_id);
+        if (cached && !cached->expired) {
+            resolved->emplace(mod_id, make_lookup(cached->mod));
+            continue;
+        }
+        // Заглушка, чтобы повторяющиеся id не попали в промахи дважды
+        resolved->emplace(mod_id, ModLookup{});
+        misses.push_back(mod_id);
+    }
+
+    auto reply = [resolved, mod_ids = std::move(mod_ids), reply_to, handler = std::move(handler)]() {
+        BatchResult results;
+        results.reserve(mod_ids.size());
+        for (int mod_id : mod_ids) {
+            results.push_back(resolved->at(mod_id));
+        }
+        boost::asio::post(reply_to, [handler, results = std::move(results)]() { handler(results); });
+    };
+
+    if (misses.empty()) {
+        reply();
+        return true;
+    }
+
+    auto resolve = [resolved](const std::vector<int>& ids, std::vector<ModLookup> lookups) {
+        for (std::size_t i = 0; i < ids.size(); ++i) {
+            (*resolved)[ids[i]] = std::move(lookups[i]);
+        }
+    };
+
+    if (!breaker_.allow()) {
+        resolve(misses, staleLookups(misses));
+        reply();
+        return true;
+    }
+
+    bool queued = executor_.post([this, resolve, misses = std::move(misses), reply = std::move(reply)]() {
+        resolve(misses, loadMods(misses));
+        reply();
+    });
+    if (!queued) {
+        breaker_.cancel();
+    }
+    return queued;
+}
+
+ModLookup ModService::staleLookup(int mod_id, const std::optional<ModCache::Hit>& cached) const {
+    ModLookup lookup;
+    if (cached && cached->mod) {
+        lookup.mod = cached->mod;
+    } else if (auto snapshot = catalog_.current()) {
+        if (auto entry = snapshot->entry(mod_id)) {
+            // Указатель на мод внутри записи снимка, запись живёт вместе с ним
+            lookup.mod = std::shared_ptr<const ModData>(entry, &entry->mod);
+        }
+    }
+
+    if (lookup.mod) {
+        lookup.status = ModLookup::Status::Found;
+        lookup.stale = true;
+    }
+    return lookup;
+}
+
+std::vector<ModLookup> ModService::staleLookups(const std::vector<int>& mod_ids) {
+    std::vector<ModLookup> lookups;
+    lookups.reserve(mod_ids.size());
+    for (int mod_id : mod_ids) {
+        lookups.push_back(staleLookup(mod_id, cache_.get(mod_id)));
+    }
+    return lookups;
+}
+
+bool ModService::applyWrite(ModWrite write, ReplyExecutor reply_to, WriteHandler handler) {
+    std::lock_guard<std::mutex> lock(write_mutex_);
+    // Очередь проверяем до allow(), чтобы отказ не занимал пробу автомата
+    if (pending_writes_.size() >= write_options_.queue_limit) {
+        return false;
+    }
+    // Цепь разомкнута: не ставим запись в очередь, где она дождалась бы только таймаута
+    if (!breaker_.allow()) {
+        boost::asio::post(reply_to, [handler = std::move(handler)]() {
+            handler(ModWriteResult{});
+        });
+        return true;
+    }
+    pending_writes_.push_back({std::move(write), std::move(reply_to), std::move(handler)});
+    if (!write_in_flight_) {
+        startWriteBatchLocked();
+    }
+    return true;
+}
+
+void ModService::startWriteBatchLocked() {
+    std::vector<PendingWrite> batch;
+    if (pending_writes_.size() <= write_options_.max_batch) {
+        batch.swap(pending_writes_);
+    } else {
+        auto end = pending_writes_.begin() + static_cast<std::ptrdiff_t>(write_options_.max_batch);
+        batch.assign(std::make_move_iterator(pending_writes_.begin()), std::make_move_iterator(end));
+        pending_writes_.erase(pending_writes_.begin(), end);
+    }
+    write_in_flight_ = true;
+
+    auto shared = std::make_shared<std::vector<PendingWrite>>(std::move(batch));
+    bool queued = executor_.post([this, shared]() { commitWrites(std::move(*shared)); });
+    if (!queued) {
+        // Пул БД переполнен: отвечаем группе отказом, а очередь продолжит следующая запись.
+        // Пробы, занятые записями группы, отпускаем: до БД они не дошли
+        write_in_flight_ = false;
+        for (auto& pending : *shared) {
+            breaker_.cancel();
+            boost::asio::post(pending.reply_to, [handler = std::move(pending.handler)]() {
+                handler(ModWriteResult{});
+            });
+        }
+    }
+}
+
+void ModService::commitWrites(std::vector<PendingWrite> batch) {
+    std::vector<ModWrite> writes;
+    writes.reserve(batch.size());
+    for (const auto& pending : batch) {
+        writes.push_back(pending.write);
+    }
+
+    std::vector<ModWriteResult> results;
+    bool ok = false;
+    try {
+        ok = storage_.applyWrites(writes, results);
+    } catch (const std::exception& e) {
+        log_message("Database task error: " + std::string(e.what()), "ERROR");
+    }
+
+    if (ok) {
+        breaker_.recordSuccess();
+        log_message("Group commit: " + std::to_string(writes.size()) + " writes in one transaction", "DEBUG");
+        publishWrites(writes, results);
+    } else {
+        breaker_.recordFailure();
+        results.assign(batch.size(), ModWriteResult{});
+    }
+
+    for (std::size_t i = 0; i < batch.size(); ++i) {
+        boost::asio::post(batch[i].reply_to, [handler = std::move(batch[i].handler), result = std::move(results[i])]() {
+            handler(result);
+        });
+    }
+
+    // Всё, что накопилось за время этой транзакции, уходит следующей
+    std::lock_guard<std::mutex> lock(write_mutex_);
+    write_in_flight_ = false;
+    if (!pending_writes_.empty()) {
+        startWriteBatchLocked();
+    }
+}
+
+void ModService::publishWrites(const std::vector<ModWrite>& writes, const std::vector<ModWriteResult>& results) {
+    // Итог по каждому id - последняя успешная запись в нём
+    std::unordered_map<int, std::size_t> latest;
+    std::vector<int> order;
+    for (std::size_t i = 0; i < results.size(); ++i) {
+        if (results[i].status != ModWriteResult::Status::Ok) {
+            continue;
+        }
+        if (latest.emplace(results[i].mod.id, i).second) {
+            order.push_back(results[i].mod.id);
+        } else {
+            latest[results[i].mod.id] = i;
+        }
+    }
+    if (order.empty()) {
+        return;
+    }
+
+    // Кэш сразу получает новые значения: чтение с отстающей реплики не вернёт старое.
+    // Инвалидация до put обрывает загрузки, начатые до фиксации
+    cache_.invalidate(order);
+    auto generation = cache_.generation();
+
+    ModChanges changes;
+    for (int mod_id : order) {
+        std::size_t index = latest[mod_id];
+        const auto& result = results[index];
+        if (writes[index].op == ModWrite::Op::Delete) {
+            cache_.put(mod_id, std::nullopt, generation);
+            changes.deleted.push_back(mod_id);
+        } else {
+            cache_.put(mod_id, result.mod, generation);
+            changes.updated.push_back(result.mod);
+        }
+    }
+
+    // Без снимка патчить нечего: первая загрузка каталога уже увидит запись.
+    // Если параллельно идёт обновление, начатое до COMMIT, оно может на время вернуть
+    // старое значение в снимок; следующая инкрементальная выборка это исправит
+    catalog_.apply(std::move(changes));
+}
+
+bool ModService::recordCounter(int mod_id, ModCounters::Kind kind) {
+    // Пока снимка нет, проверить id не по чему; несуществующие id БД просто пропустит
+    auto snapshot = catalog_.current();
+    if (snapshot && !snapshot->find(mod_id)) {
+        return false;
+    }
+    counters_.add(mod_id, kind);
+    return true;
+}
+
+bool ModService::flushCounters() {
+    auto deltas = counters_.drain();
+    if (deltas.empty()) {
+        return true;
+    }
+    if (!breaker_.allow()) {
+        counters_.restore(deltas);
+        return false;
+    }
+
+    auto status = CounterWriteStatus::Failed;
+    try {
+        status = storage_.addCounters(deltas);
+    } catch (const std::exception& e) {
+        log_message("Database task error: " + std::string(e.what()), "ERROR");
+    }
+    if (status == CounterWriteStatus::Unknown) {
+        // Ни повтора, ни наложения в памяти: иначе отдаваемые счётчики могли бы разойтись с БД
+        // до следующей полной загрузки. Если приращения всё же сохранились, их принесёт она
+        breaker_.recordFailure();
+        log_message("Counter flush outcome unknown, " + std::to_string(deltas.size()) +
+                    " mods not applied in memory", "WARNING");
+        return false;
+    }
+    if (status == CounterWriteStatus::Failed) {
+        breaker_.recordFailure();
+        counters_.restore(deltas);
+        log_message("Counter flush failed, " + std::to_string(deltas.size()) + " mods kept for the next flush",
+                    "WARNING");
+        return false;
+    }
+    breaker_.recordSuccess();
+    log_message("Flushed counters for " + std::to_string(deltas.size()) + " mods", "DEBUG");
+
+    // Кэш получает новые значения сразу: инвалидация здесь выбросила бы из него как раз самые
+    // популярные моды. Загрузка, начатая до COMMIT, может положить в кэш значение без этих
+    // приращений; оно доживёт до TTL, для счётчиков это допустимо. Снимок получит их
+    // при следующем наложении изменений, пересобирать каталог на каждый сброс незачем
+    catalog_.addCounters(deltas);
+    cache_.addCounters(deltas);
+    return true;
+}
+
+void ModService::startCounterFlush(std::chrono::milliseconds interval) {
+    counter_interval_ = interval;
+    scheduleCounterFlush();
+}
+
+void ModService::scheduleCounterFlush() {
+    counter_timer_.expires_after(counter_interval_);
+    counter_timer_.async_wait([this](const boost::system::error_code& ec) {
+        if (ec) {
+            return;
+        }
+
+        bool queued = executor_.post([this]() {
+            flushCounters();
+            boost::asio::post(io_context_, [this]() { scheduleCounterFlush(); });
+        });
+        if (!queued) {
+            scheduleCounterFlush();
+        }
+    });
+}
+
+void ModService::invalidateMods(const std::vector<int>& mod_ids) {
+    cache_.invalidate(mod_ids);
+}
+
+bool ModService::refreshCatalog() {
+    // Не запускаем параллельную загрузку, если предыдущая ещё идёт
+    if (refreshing_.exchange(true)) {
+        return false;
+    }
+    if (!breaker_.allow()) {
+        refreshing_ = false;
+        return false;
+    }
+
+    bool ok = loadFullCatalog();
+    if (ok) {
+        breaker_.recordSuccess();
+    } else {
+        breaker_.recordFailure();
+    }
+    refreshing_ = false;
+    return ok;
+}
+
+void ModService::runScheduledRefresh() {
+    if (refreshing_.exchange(true)) {
+        return;
+    }
+    // При разомкнутой цепи продолжаем отдавать текущий снимок, не трогая БД
+    if (!breaker_.allow()) {
+        log_message("Database circuit is open, skipping catalog refresh", "DEBUG");
+        refreshing_ = false;
+        return;
+    }
+
+    bool incremental = catalog_.current() && !watermark_.empty() &&
+                       refreshes_since_full_ + 1 < full_refresh_every_;
+    bool ok = incremental && loadCatalogChanges();
+    if (!ok) {
+        ok = loadFullCatalog();
+    }
+    if (ok) {
+        breaker_.recordSuccess();
+    } else {
+        breaker_.recordFailure();
+    }
+
+    refreshing_ = false;
+}
+
+bool ModService::loadFullCatalog() {
+    // Отметку берём до загрузки, чтобы следующая выборка изменений ничего не пропустила
+    auto watermark = storage_.getServerTime();
+
+    // Строки сразу превращаются в записи снимка, промежуточного вектора ModData нет
+    std::vector<std::shared_ptr<const CatalogEntry>> entries;
+    bool loaded = watermark && storage_.streamAllMods([&entries](ModData&& mod) {
+        entries.push_back(Catalog::makeEntry(std::move(mod)));
+    });
+    if (!loaded) {
+        auto snapshot = catalog_.current();
+        log_message("Catalog refresh failed, keeping snapshot v" +
+                    std::to_string(snapshot ? snapshot->version : 0), "WARNING");
+        return false;
+    }
+
+    catalog_.publish(std::move(entries));
+    // После полной перезагрузки неизвестно, что именно изменилось
+    cache_.clear();
+    watermark_ = *watermark;
+    refreshes_since_full_ = 0;
+    if (catalog_from_file_.exchange(false)) {
+        log_message("Catalog loaded from file replaced with data from the database", "INFO");
+    }
+    return true;
+}
+
+bool ModService::loadCatalogChanges() {
+    auto changes = storage_.getModChanges(watermark_);
+    if (!changes) {
+        log_message("Incremental catalog refresh failed, falling back to full reload", "WARNING");
+        return false;
+    }
+
+    std::string watermark = changes->watermark;
+    std::vector<int> changed_ids = changes->deleted;
+    for (const auto& mod : changes->updated) {
+        changed_ids.push_back(mod.id);
+    }
+
+    if (!catalog_.apply(std::move(*changes))) {
+        return false;
+    }
+    invalidateMods(changed_ids);
+    watermark_ = std::move(watermark);
+    ++refreshes_since_full_;
+    return true;
+}
+
+void ModService::startCatalogRefresh(std::chrono::seconds interval, int full_refresh_every) {
+    refresh_interval_ = interval;
+    full_refresh_every_ = full_refresh_every;
+    scheduleRefresh();
+}
+
+void ModService::scheduleRefresh() {
+    refresh_timer_.expires_after(refresh_interval_);
+    refresh_timer_.async_wait([this](const boost::system::error_code& ec) {
+        if (ec) {
+            return;
+        }
+
+        // Загрузка идёт в пуле БД, следующий таймер ставим уже после неё
+        bool queued = executor_.post([this]() {
+            runScheduledRefresh();
+            boost::asio::post(io_context_, [this]() { scheduleRefresh(); });
+        });
+        if (!queued) {
+            scheduleRefresh();
+        }
+    });
+}
+
+bool ModService::loadCatalogFile(const std::string& path) {
+    auto entries = load_catalog_file(path);
+    if (!entries) {
+        return false;
+    }
+    auto snapshot = catalog_.publish(std::move(*entries));
+    // watermark_ пуст, поэтому первое обновление из БД будет полным
+    catalog_from_file_ = true;
+    saved_version_ = snapshot->version;
+    return true;
+}
+
+bool ModService::saveCatalogFile() {
+    auto snapshot = catalog_.current();
+    if (catalog_file_.empty() || !snapshot) {
+        return false;
+    }
+    // Сохранение с таймера и при остановке не должны писать один временный файл одновременно
+    std::lock_guard<std::mutex> lock(persist_mutex_);
+    if (snapshot->version == saved_version_) {
+        return true;
+    }
+    if (!save_catalog_file(*snapshot, catalog_file_)) {
+        return false;
+    }
+    saved_version_ = snapshot->version;
+    return true;
+}
+
+void ModService::startCatalogPersistence(const std::string& path, std::chrono::seconds interval) {
+    catalog_file_ = path;
+    persist_interval_ = interval;
+    scheduleCatalogPersistence();
+}
+
+void ModService::scheduleCatalogPersistence() {
+    persist_timer_.expires_after(persist_interval_);
+    persist_timer_.async_wait([this](const boost::system::error_code& ec) {
+        if (ec) {
+            return;
+        }
+
+        // Запись файла блокирующая, поэтому выполняется в пуле БД, а не в потоке io_context
+        bool queued = executor_.post([this]() {
+            saveCatalogFile();
+            boost::asio::post(io_context_, [this]() { scheduleCatalogPersistence(); });
+        });
+        if (!queued) {
+            scheduleCatalogPersistence();
+        }
+    });
+}
+
+void ModService::startMaintenance(std::chrono::seconds interval) {
+    maintenance_interval_ = interval;
+    scheduleMaintenance();
+}
+
+void ModService::scheduleMaintenance() {
+    maintenance_timer_.expires_after(maintenance_interval_);
+    maintenance_timer_.async_wait([this](const boost::system::error_code& ec) {
+        if (ec) {
+            return;
+        }
+
+        // Проверки блокирующие, поэтому выполняются в пуле БД, а не в потоке io_context
+        bool queued = executor_.post([this]() {
+            storage_.maintain();
+            boost::asio::post(io_context_, [this]() { scheduleMaintenance(); });
+        });
+        if (!queued) {
+            scheduleMaintenance();
+        }
+    });
+}
@@ -0,0 +1,243 @@
+#ifndef MOD_SERVICE_H
+#define MOD_SERVICE_H
+
+#include <boost/asio.hpp>
+#include <atomic>
+#include <cstdint>
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+#include "mod_storage.h"
+#include "logger.h"
+#include "db_executor.h"
+#include "catalog.h"
+#include "single_flight.h"
+#include "mod_cache.h"
+#include "circuit_breaker.h"
+#include "mod_counters.h"
+
+// Результат поиска мода по id
+struct ModLookup {
+    enum class Status { Found, NotFound, Unavailable };
+    Status status = Status::Unavailable;
+    std::shared_ptr<const ModData> mod;
+    // БД недоступна, и мод взят из последних известных данных (кэш или снимок каталога)
+    bool stale = false;
+};
+
+// Сбор промахов GET_MOD_BY_ID в пакеты (DataLoader): id, пришедшие в течение window
+// из разных сессий, загружаются одним запросом getModsByIds
+struct LookupBatchOptions {
+    // Сколько ждать после первого промаха; 0 отключает пакетирование
+    std::chrono::microseconds window{1000};
+    // Пакет уходит сразу, как только набралось столько id
+    std::size_t max_keys = 64;
+};
+
+// Групповая фиксация записей: пока одна транзакция выполняется, новые записи копятся
+// и уходят следующей транзакцией целиком, так что число COMMIT растёт медленнее числа записей
+struct WriteBatchOptions {
+    // Команды записи выключены по умолчанию: сервер не проверяет, кто их прислал
+    bool enabled = false;
+    // Сколько записей помещается в одну транзакцию
+    std::size_t max_batch = 256;
+    // Сколько записей может ждать своей транзакции; дальше - отказ "Server busy"
+    std::size_t queue_limit = 4096;
+};
+
+// Асинхронный фасад над хранилищем модов (ModStorage) для сессий.
+// Запросы выполняются на DbExecutor, а результат возвращается
+// на executor сессии, так что сетевые потоки не блокируются на MySQL.
+// Одновременные одинаковые запросы объединяются в одну загрузку из БД.
+class ModService {
+public:
+    using ReplyExecutor = boost::asio::any_io_executor;
+    using SnapshotResult = std::shared_ptr<const CatalogSnapshot>;
+    using ModResult = ModLookup;
+    using SnapshotHandler = std::function<void(const SnapshotResult&)>;
+    using ModHandler = std::function<void(const ModResult&)>;
+    // Результаты пакетного поиска в порядке запрошенных id
+    using BatchResult = std::vector<ModLookup>;
+    using BatchHandler = std::function<void(const BatchResult&)>;
+    using WriteHandler = std::function<void(const ModWriteResult&)>;
+
+    ModService(boost::asio::io_context& io_context, ModStorage& storage, DbExecutor& executor,
+               const ModCacheOptions& cache_options, const CircuitBreakerOptions& breaker_options,
+               const LookupBatchOptions& batch_options = {}, const WriteBatchOptions& write_options = {});
+
+    // Поиск по id при промахе кэша идёт через неблокирующий источник вместо DbExecutor.
+    // Вызывать до приёма соединений; nullptr возвращает блокирующий путь
+    void setAsyncSource(AsyncModSource* source) { async_source_ = source; }
+
+    // Возвращают false, если очередь DbExecutor переполнена; обработчик тогда не вызывается.
+    // loadCatalog нужен, только пока снимка нет: загружает и публикует его (nullptr при ошибке)
+    bool loadCatalog(ReplyExecutor reply_to, SnapshotHandler handler);
+    // Сначала смотрит в кэш (включая отрицательные записи), при промахе идёт в БД.
+    // Если БД недоступна или цепь разомкнута, отдаёт последнее известное значение с пометкой stale
+    bool getModById(int mod_id, ReplyExecutor reply_to, ModHandler handler);
+    // Пакетный вариант getModById: найденное в кэше отдаётся сразу, остальные id
+    // загружаются из хранилища одним пакетным запросом
+    bool getModsByIds(std::vector<int> mod_ids, ReplyExecutor reply_to, BatchHandler handler);
+
+    bool writesEnabled() const { return write_options_.enabled; }
+    // Ставит запись в очередь групповой фиксации. После COMMIT кэш и снимок каталога
+    // сразу отражают запись, не дожидаясь фонового обновления.
+    // false - очередь записей или пула БД переполнена; обработчик тогда не вызывается
+    bool applyWrite(ModWrite write, ReplyExecutor reply_to, WriteHandler handler);
+
+    // Учитывает скачивание или просмотр в памяти; в БД приращения уходят пачкой при сбросе.
+    // false - мода нет в текущем снимке каталога
+    bool recordCounter(int mod_id, ModCounters::Kind kind);
+    // Сохраняет накопленные приращения одним пакетом (блокирующий вызов). При ошибке
+    // приращения возвращаются в память и уйдут со следующим сбросом
+    bool flushCounters();
+    // Запускает периодический сброс счётчиков: при падении процесса теряется не больше interval
+    void startCounterFlush(std::chrono::milliseconds interval);
+
+    // Сбрасывает кэшированные записи модов, которые изменились или были удалены
+    void invalidateMods(const std::vector<int>& mod_ids);
+
+    // Текущий снимок каталога; nullptr, пока каталог ни разу не загружен.
+    // Чтение не берёт блокировок и не обращается к MySQL
+    std::shared_ptr<const CatalogSnapshot> catalog() const { return catalog_.current(); }
+    // Снимок может быть устаревшим: БД сейчас считается недоступной
+    // или каталог поднят из файла и ещё ни разу не перечитан из БД
+    bool catalogStale() const {
+        return catalog_from_file_ || breaker_.state() != CircuitBreaker::State::Closed;
+    }
+    std::string breakerState() const { return CircuitBreaker::stateName(breaker_.state()); }
+
+    // Загружает весь каталог из БД и публикует новый снимок (блокирующий вызов)
+    bool refreshCatalog();
+    // Запускает периодическое обновление снимка в фоне: обычно инкрементальное,
+    // а каждые full_refresh_every циклов (и при ошибке инкрементальной выборки) - полное
+    void startCatalogRefresh(std::chrono::seconds interval, int full_refresh_every);
+    // Публикует каталог из файла снимка, не обращаясь к БД. Снимок считается устаревшим
+    // до первой успешной полной загрузки из БД
+    bool loadCatalogFile(const std::string& path);
+    // Сохраняет текущий снимок в файл, если он изменился с прошлого сохранения (блокирующий вызов)
+    bool saveCatalogFile();
+    // Запускает периодическое сохранение снимка в path
+    void startCatalogPersistence(const std::string& path, std::chrono::seconds interval);
+    // Запускает фоновое обслуживание хранилища (keepalive соединений, проверка реплик) с заданным интервалом
+    void startMaintenance(std::chrono::seconds interval);
+
+private:
+    // Выполняет work на пуле БД один раз для всех одновременных запросов с тем же ключом
+    // и передаёт общий результат каждому handler на его reply_to
+    // started, если задан, выставляется, когда запрос сам запустил загрузку, а не присоединился к идущей
+    template <typename Key, typename Value, typename Work>
+    bool runShared(SingleFlight<Key, Value>& flights, const Key& key, ReplyExecutor reply_to,
+                   std::function<void(const Value&)> handler, Work work, bool* started = nullptr) {
+        return flights.join(key, makeWaiter(std::move(reply_to), std::move(handler)),
+                            [this, &flights, key, work = std::move(work), started]() {
+            if (started) {
+                *started = true;
+            }
+            return executor_.post([&flights, key, work]() {
+                Value value{};
+                try {
+                    value = work();
+                } catch (const std::exception& e) {
+                    log_message("Database task error: " + std::string(e.what()), "ERROR");
+                }
+                flights.complete(key, std::move(value));
+            });
+        });
+    }
+
+    // Ожидающий single-flight, который передаёт общий результат handler на его reply_to
+    template <typename Value>
+    static typename SingleFlight<int, Value>::Waiter makeWaiter(ReplyExecutor reply_to,
+                                                                std::function<void(const Value&)> handler) {
+        return [reply_to, handler = std::move(handler)](const std::shared_ptr<const Value>& result) {
+            boost::asio::post(reply_to, [handler, result]() { handler(*result); });
+        };
+    }
+
+    // Итог загрузки мода из хранилища: обновляет автомат защиты и кэш
+    ModLookup finishLookup(int mod_id, bool ok, std::optional<ModData>&& mod, std::uint64_t generation);
+    // started выставляется, если запрос сам запустил загрузку
+    bool getModByIdAsync(int mod_id, ReplyExecutor reply_to, ModHandler handler, bool& started);
+    // Добавляет id в текущий пакет. Вызывается из start() single-flight под его мьютексом,
+    // поэтому сам никогда не завершает загрузку
+    bool enqueueBatched(int mod_id);
+    // Отправляет накопленный пакет в пул БД; вызывать под batch_mutex_
+    void flushBatchLocked();
+    void loadBatch(const std::vector<int>& mod_ids);
+    // Загружает моды одним запросом к хранилищу, обновляет автомат защиты и кэш.
+    // Итог по каждому id в порядке mod_ids; при ошибке БД - запасные ответы
+    std::vector<ModLookup> loadMods(const std::vector<int>& mod_ids);
+
+    struct PendingWrite {
+        ModWrite write;
+        ReplyExecutor reply_to;
+        WriteHandler handler;
+    };
+
+    // Отправляет очередную группу записей в пул БД; вызывать под write_mutex_
+    void startWriteBatchLocked();
+    void commitWrites(std::vector<PendingWrite> batch);
+    // Накладывает зафиксированные записи на кэш и снимок каталога
+    void publishWrites(const std::vector<ModWrite>& writes, const std::vector<ModWriteResult>& results);
+
+    // Запасной ответ при недоступной БД: просроченная запись кэша или мод из снимка
+    ModLookup staleLookup(int mod_id, const std::optional<ModCache::Hit>& cached) const;
+    std::vector<ModLookup> staleLookups(const std::vector<int>& mod_ids);
+
+    void scheduleRefresh();
+    void scheduleMaintenance();
+    void scheduleCounterFlush();
+    void scheduleCatalogPersistence();
+    void runScheduledRefresh();
+    bool loadFullCatalog();
+    bool loadCatalogChanges();
+
+    boost::asio::io_context& io_context_;
+    ModStorage& storage_;
+    DbExecutor& executor_;
+    AsyncModSource* async_source_ = nullptr;
+    Catalog catalog_;
+    ModCache cache_;
+    CircuitBreaker breaker_;
+    SingleFlight<int, SnapshotResult> catalog_flights_;
+    SingleFlight<int, ModResult> mod_flights_;
+    LookupBatchOptions batch_options_;
+    std::mutex batch_mutex_;
+    std::vector<int> batch_ids_;
+    // Номер текущего пакета: таймер уже отправленного пакета ничего не делает
+    unsigned long long batch_number_ = 0;
+    boost::asio::steady_timer batch_timer_;
+    WriteBatchOptions write_options_;
+    std::mutex write_mutex_;
+    std::vector<PendingWrite> pending_writes_;
+    // Группа записей сейчас фиксируется; следующая уйдёт после неё
+    bool write_in_flight_ = false;
+    boost::asio::steady_timer refresh_timer_;
+    std::chrono::seconds refresh_interval_{30};
+    boost::asio::steady_timer maintenance_timer_;
+    ModCounters counters_;
+    boost::asio::steady_timer counter_timer_;
+    std::chrono::milliseconds counter_interval_{5000};
+    std::string catalog_file_;
+    boost::asio::steady_timer persist_timer_;
+    std::chrono::seconds persist_interval_{60};
+    // Версия снимка, уже лежащая в файле; 0 - ничего не сохранялось
+    std::atomic<std::uint64_t> saved_version_{0};
+    std::mutex persist_mutex_;
+    std::atomic<bool> catalog_from_file_{false};
+    std::chrono::seconds maintenance_interval_{5};
+    int full_refresh_every_ = 60;
+    int refreshes_since_full_ = 0;
+    // Время сервера БД, с которого начнётся следующая инкрементальная выборка.
+    // Меняется только внутри refreshing_
+    std::string watermark_;
+    std::atomic<bool> refreshing_{false};
+};
+
+#endif // MOD_SERVICE_H
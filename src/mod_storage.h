@@ -0,0 +1,126 @@
+#ifndef MOD_STORAGE_H
+#define MOD_STORAGE_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <optional>
+#include <functional>
+
+struct ModData {
+    int id;
+    std::string name;
+    std::string description;
+    std::string link;
+    std::vector<std::string> media_links;
+    std::string category;
+    // Счётчики популярности на момент чтения из хранилища; несохранённые приращения в них не входят
+    std::uint64_t downloads = 0;
+    std::uint64_t views = 0;
+};
+
+// Накопленное в памяти приращение счётчиков одного мода
+struct ModCounterDelta {
+    int mod_id = 0;
+    std::uint64_t downloads = 0;
+    std::uint64_t views = 0;
+};
+
+// Итог сохранения приращений счётчиков
+enum class CounterWriteStatus {
+    Saved,    // приращения сохранены
+    Failed,   // ничего не сохранено, приращения можно отправить повторно
+    Unknown   // соединение оборвалось на COMMIT: повтор мог бы посчитать приращения дважды,
+              // а наложение в памяти - показать несохранённые
+};
+
+// Изменения каталога с момента предыдущей загрузки
+struct ModChanges {
+    std::vector<ModData> updated;  // добавленные и изменённые моды вместе с медиа
+    std::vector<int> deleted;      // id удалённых модов
+    std::string watermark;         // отметка хранилища на момент начала выборки
+};
+
+// Одна запись в каталог. В Update заполнены только меняемые поля
+struct ModWrite {
+    enum class Op { Add, Update, Delete };
+    Op op = Op::Add;
+    // Add: 0 - id назначит хранилище
+    int id = 0;
+    std::optional<std::string> name;
+    std::optional<std::string> description;
+    std::optional<std::string> link;
+    std::optional<std::string> category;
+    std::optional<std::vector<std::string>> media_links;
+};
+
+// Итог одной записи
+struct ModWriteResult {
+    // Conflict - Add с id уже существующего мода; Rejected - хранилище отвергло данные
+    enum class Status { Ok, NotFound, Conflict, Rejected, Unavailable };
+    Status status = Status::Unavailable;
+    // Мод после записи (для Add - с назначенным id); для Delete - только id
+    ModData mod{};
+};
+
+// Переносит в mod поля, заданные в write
+inline void merge_mod_write(ModData& mod, const ModWrite& write) {
+    if (write.name) mod.name = *write.name;
+    if (write.description) mod.description = *write.description;
+    if (write.link) mod.link = *write.link;
+    if (write.category) mod.category = *write.category;
+    if (write.media_links) mod.media_links = *write.media_links;
+}
+
+// Хранилище модов, от которого зависит ModService (а через него и Session).
+// Основная реализация - Database (MySQL); SyntheticStorage держит
+// сгенерированный каталог в памяти для нагрузочных тестов без MySQL.
+// Все методы блокирующие и вызываются из пула DbExecutor.
+class ModStorage {
+public:
+    using ModConsumer = std::function<void(ModData&&)>;
+
+    virtual ~ModStorage() = default;
+
+    virtual bool connect() = 0;
+
+    // Потоковое чтение всего каталога: моды передаются в consume по одному в порядке id.
+    // false - ошибка; часть модов к этому моменту уже могла быть передана
+    virtual bool streamAllMods(const ModConsumer& consume) = 0;
+    // false - ошибка хранилища; true и пустой found - мода с таким id нет
+    virtual bool getModById(int mod_id, std::optional<ModData>& found) = 0;
+    // Пакетный поиск: в found попадают только существующие моды, в любом порядке.
+    // false - ошибка хранилища
+    virtual bool getModsByIds(const std::vector<int>& mod_ids, std::vector<ModData>& found) = 0;
+
+    // Отметка, с которой начнётся следующая инкрементальная выборка
+    virtual std::optional<std::string> getServerTime() = 0;
+    // Моды, изменённые или удалённые начиная с отметки since
+    virtual std::optional<ModChanges> getModChanges(const std::string& since) = 0;
+
+    // Применяет пакет записей одной транзакцией, по порядку: более поздняя запись видит
+    // результат более ранней. results - по одному на запись. false - ошибка хранилища,
+    // ни одна запись не применена
+    virtual bool applyWrites(const std::vector<ModWrite>& writes, std::vector<ModWriteResult>& results) = 0;
+    // Прибавляет приращения к счётчикам модов (несуществующие id пропускаются)
+    virtual CounterWriteStatus addCounters(const std::vector<ModCounterDelta>& deltas) = 0;
+
+    // Периодическое фоновое обслуживание (проверка реплик и т.п.)
+    virtual void maintain() {}
+};
+
+// Неблокирующий поиск мода по id, выполняемый прямо в io_context без пула потоков.
+// Реализация - AsyncMySqlClient (неблокирующий C API MySQL 8)
+class AsyncModSource {
+public:
+    // ok = false - ошибка хранилища; ok = true и пустой mod - мода с таким id нет
+    using LookupCallback = std::function<void(bool ok, std::optional<ModData>&& mod)>;
+
+    virtual ~AsyncModSource() = default;
+
+    // Ставит запрос в очередь; false - очередь переполнена, callback не будет вызван.
+    // callback никогда не вызывается изнутри getModById, только позже из io_context
+    virtual bool getModById(int mod_id, LookupCallback callback) = 0;
+};
+
+#endif // MOD_STORAGE_H
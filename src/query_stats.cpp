@@ -0,0 +1,226 @@
+#include "query_stats.h"
+#include "logger.h"
+#include <algorithm>
+#include <cctype>
+#include <ctime>
+#include <iomanip>
+#include <sstream>
+
+void LatencyHistogram::record(std::chrono::microseconds duration, bool ok) {
+    auto us = static_cast<std::uint64_t>(std::max<long long>(duration.count(), 0));
+
+    // Корзина i содержит задержки из [2^(i-1), 2^i) мкс, последняя - всё, что дольше
+    std::size_t bucket = 0;
+    while (bucket + 1 < BUCKETS && (std::uint64_t{1} << bucket) <= us) {
+        ++bucket;
+    }
+    buckets_[bucket].fetch_add(1, std::memory_order_relaxed);
+    sum_us_.fetch_add(us, std::memory_order_relaxed);
+    if (!ok) {
+        errors_.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    std::uint64_t max = max_us_.load(std::memory_order_relaxed);
+    while (us > max && !max_us_.compare_exchange_weak(max, us, std::memory_order_relaxed)) {
+    }
+}
+
+double LatencyHistogram::percentile(const std::array<std::uint64_t, BUCKETS>& counts, std::uint64_t total,
+                                    double p) const {
+    auto rank = static_cast<std::uint64_t>(p * static_cast<double>(total));
+    std::uint64_t seen = 0;
+    for (std::size_t i = 0; i < BUCKETS; ++i) {
+        seen += counts[i];
+        if (seen > rank) {
+            // Верхняя граница корзины, но не больше наблюдавшегося максимума
+            double upper_us = static_cast<double>(std::uint64_t{1} << i);
+            return std::min(upper_us, static_cast<double>(max_us_.load())) / 1000.0;
+        }
+    }
+    return static_cast<double>(max_us_.load()) / 1000.0;
+}
+
+LatencyHistogram::Summary LatencyHistogram::summary() const {
+    std::array<std::uint64_t, BUCKETS> counts{};
+    std::uint64_t total = 0;
+    for (std::size_t i = 0; i < BUCKETS; ++i) {
+        counts[i] = buckets_[i].load(std::memory_order_relaxed);
+        total += counts[i];
+    }
+
+    Summary summary;
+    summary.count = total;
+    summary.errors = errors_.load(std::memory_order_relaxed);
+    if (total == 0) {
+        return summary;
+    }
+    summary.mean_ms = static_cast<double>(sum_us_.load(std::memory_order_relaxed)) / total / 1000.0;
+    summary.p50_ms = percentile(counts, total, 0.50);
+    summary.p95_ms = percentile(counts, total, 0.95);
+    summary.p99_ms = percentile(counts, total, 0.99);
+    summary.max_ms = static_cast<double>(max_us_.load(std::memory_order_relaxed)) / 1000.0;
+    return summary;
+}
+
+static constexpr std::size_t MAX_SHAPE_LENGTH = 512;
+
+QueryStats& query_stats() {
+    static QueryStats stats;
+    return stats;
+}
+
+void QueryStats::configure(const QueryStatsOptions& options) {
+    slow_threshold_us_ = std::chrono::duration_cast<std::chrono::microseconds>(options.slow_threshold).count();
+    slow_log_size_ = options.slow_log_size;
+}
+
+const char* QueryStats::kindName(QueryKind kind) {
+    switch (kind) {
+        case QueryKind::Connect: return "connect";
+        case QueryKind::Ping: return "ping";
+        case QueryKind::AllMods: return "all_mods";
+        case QueryKind::ById: return "by_id";
+        case QueryKind::Batch: return "batch";
+        case QueryKind::Media: return "media";
+        case QueryKind::Changes: return "changes";
+        case QueryKind::ServerTime: return "server_time";
+        case QueryKind::Write: return "write";
+        default: return "unknown";
+    }
+}
+
+std::string QueryStats::sqlShape(const std::string& sql) {
+    std::string shape;
+    shape.reserve(sql.size());
+
+    for (std::size_t i = 0; i < sql.size();) {
+        char c = sql[i];
+        bool prev_is_word = !shape.empty() &&
+            (std::isalnum(static_cast<unsigned char>(shape.back())) || shape.back() == '_');
+
+        if (c == '\'' || c == '"') {
+            // Строковый литерал с учётом экранирования
+            std::size_t j = i + 1;
+            while (j < sql.size() && sql[j] != c) {
+                j += sql[j] == '\\' ? 2 : 1;
+            }
+            shape += '?';
+            i = std::min(j + 1, sql.size());
+        } else if (std::isdigit(static_cast<unsigned char>(c)) && !prev_is_word) {
+            while (i < sql.size() && (std::isdigit(static_cast<unsigned char>(sql[i])) || sql[i] == '.')) {
+                ++i;
+            }
+            shape += '?';
+        } else {
+            shape += c;
+            ++i;
+        }
+    }
+
+    // Списки "?,?,?" сворачиваем в "?,..."
+    std::string collapsed;
+    collapsed.reserve(shape.size());
+    for (std::size_t i = 0; i < shape.size(); ++i) {
+        collapsed += shape[i];
+        if (shape[i] == '?' && i + 2 < shape.size() && shape[i + 1] == ',' && shape[i + 2] == '?') {
+            collapsed += ",...";
+            while (i + 2 < shape.size() && shape[i + 1] == ',' && shape[i + 2] == '?') {
+                i += 2;
+            }
+        }
+    }
+    // Многострочные INSERT остаются длинными и после свёртки
+    if (collapsed.size() > MAX_SHAPE_LENGTH) {
+        collapsed.resize(MAX_SHAPE_LENGTH);
+        collapsed += "...";
+    }
+    return collapsed;
+}
+
+void QueryStats::record(QueryKind kind, const char* sql, std::chrono::microseconds duration,
+                        std::uint64_t rows, unsigned long connection, bool ok) {
+    histograms_[static_cast<std::size_t>(kind)].record(duration, ok);
+
+    if (duration.count() < slow_threshold_us_.load(std::memory_order_relaxed)) {
+        return;
+    }
+
+    SlowQuery slow{std::chrono::system_clock::now(), kind, sqlShape(sql ? sql : ""), duration, rows, connection, ok};
+    log_message("Slow query (" + std::string(kindName(kind)) + ", " + std::to_string(duration.count() / 1000) +
+                " ms, " + std::to_string(rows) + " rows, connection " + std::to_string(connection) + "): " +
+                slow.sql, "WARNING");
+
+    std::lock_guard<std::mutex> lock(slow_mutex_);
+    slow_queries_.push_back(std::move(slow));
+    while (slow_queries_.size() > slow_log_size_.load()) {
+        slow_queries_.pop_front();
+    }
+}
+
+nlohmann::json QueryStats::toJson() const {
+    nlohmann::json queries = nlohmann::json::object();
+    for (std::size_t i = 0; i < histograms_.size(); ++i) {
+        auto summary = histograms_[i].summary();
+        queries[kindName(static_cast<QueryKind>(i))] = {
+            {"count", summary.count},
+            {"errors", summary.errors},
+            {"mean_ms", summary.mean_ms},
+            {"p50_ms", summary.p50_ms},
+            {"p95_ms", summary.p95_ms},
+            {"p99_ms", summary.p99_ms},
+            {"max_ms", summary.max_ms}
+        };
+    }
+
+    nlohmann::json slow = nlohmann::json::array();
+    {
+        std::lock_guard<std::mutex> lock(slow_mutex_);
+        for (const auto& query : slow_queries_) {
+            std::time_t at = std::chrono::system_clock::to_time_t(query.at);
+            std::tm tm{};
+#ifdef _WIN32
+            gmtime_s(&tm, &at);
+#else
+            gmtime_r(&at, &tm);
+#endif
+            std::ostringstream time;
+            time << std::put_time(&tm, "%Y-%m-%dT%H:%M:%SZ");
+
+            slow.push_back({
+                {"at", time.str()},
+                {"kind", kindName(query.kind)},
+                {"sql", query.sql},
+                {"duration_ms", static_cast<double>(query.duration.count()) / 1000.0},
+                {"rows", query.rows},
+                {"connection", query.connection},
+                {"ok", query.ok}
+            });
+        }
+    }
+
+    return {
+        {"queries", queries},
+        {"slow_threshold_ms", static_cast<double>(slow_threshold_us_.load()) / 1000.0},
+        {"slow_queries", slow}
+    };
+}
+
+QueryTimer::QueryTimer(QueryKind kind, const char* sql, unsigned long connection)
+    : kind_(kind), sql_(sql), connection_(connection), started_(std::chrono::steady_clock::now()) {
+}
+
+QueryTimer::~QueryTimer() {
+    if (!finished_) {
+        finish(false);
+    }
+}
+
+void QueryTimer::finish(bool ok, std::uint64_t rows) {
+    if (finished_) {
+        return;
+    }
+    finished_ = true;
+    auto duration = std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - started_);
+    query_stats().record(kind_, sql_, duration, rows, connection_, ok);
+}
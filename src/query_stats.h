@@ -0,0 +1,121 @@
+#ifndef QUERY_STATS_H
+#define QUERY_STATS_H
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <nlohmann/json.hpp>
+
+// Типы обращений к MySQL, по которым ведётся статистика
+enum class QueryKind {
+    Connect,
+    Ping,
+    AllMods,
+    ById,
+    Batch,
+    Media,
+    Changes,
+    ServerTime,
+    Write,
+    Count
+};
+
+struct QueryStatsOptions {
+    // Запросы дольше порога попадают в журнал медленных запросов
+    std::chrono::milliseconds slow_threshold{200};
+    // Сколько последних медленных запросов хранить
+    std::size_t slow_log_size = 100;
+};
+
+// Гистограмма задержек с логарифмическими корзинами (границы - степени двойки в мкс).
+// Запись без блокировок, перцентили считаются с точностью до корзины
+class LatencyHistogram {
+public:
+    struct Summary {
+        std::uint64_t count = 0;
+        std::uint64_t errors = 0;
+        double mean_ms = 0;
+        double p50_ms = 0;
+        double p95_ms = 0;
+        double p99_ms = 0;
+        double max_ms = 0;
+    };
+
+    void record(std::chrono::microseconds duration, bool ok);
+    Summary summary() const;
+
+private:
+    static constexpr std::size_t BUCKETS = 32;
+
+    double percentile(const std::array<std::uint64_t, BUCKETS>& counts, std::uint64_t total, double p) const;
+
+    std::array<std::atomic<std::uint64_t>, BUCKETS> buckets_{};
+    std::atomic<std::uint64_t> errors_{0};
+    std::atomic<std::uint64_t> sum_us_{0};
+    std::atomic<std::uint64_t> max_us_{0};
+};
+
+// Статистика обращений к БД на весь процесс: гистограмма на каждый тип запроса
+// и журнал последних медленных запросов (форма SQL, длительность, строки, соединение)
+class QueryStats {
+public:
+    void configure(const QueryStatsOptions& options);
+
+    void record(QueryKind kind, const char* sql, std::chrono::microseconds duration,
+                std::uint64_t rows, unsigned long connection, bool ok);
+
+    // Снимок статистики для команды GET_DB_STATS
+    nlohmann::json toJson() const;
+
+    static const char* kindName(QueryKind kind);
+    // Форма запроса: литералы заменены на ?, списки значений свёрнуты, чтобы
+    // запросы с разными id не выглядели разными
+    static std::string sqlShape(const std::string& sql);
+
+private:
+    struct SlowQuery {
+        std::chrono::system_clock::time_point at;
+        QueryKind kind;
+        std::string sql;
+        std::chrono::microseconds duration;
+        std::uint64_t rows;
+        unsigned long connection;
+        bool ok;
+    };
+
+    std::array<LatencyHistogram, static_cast<std::size_t>(QueryKind::Count)> histograms_;
+    std::atomic<long long> slow_threshold_us_{200000};
+    std::atomic<std::size_t> slow_log_size_{100};
+    mutable std::mutex slow_mutex_;
+    std::deque<SlowQuery> slow_queries_;
+};
+
+QueryStats& query_stats();
+
+// Замер одного обращения к БД. Если finish() не вызван, обращение записывается как ошибка.
+// sql должен жить до завершения замера
+class QueryTimer {
+public:
+    QueryTimer(QueryKind kind, const char* sql, unsigned long connection = 0);
+    ~QueryTimer();
+
+    QueryTimer(const QueryTimer&) = delete;
+    QueryTimer& operator=(const QueryTimer&) = delete;
+
+    void setConnection(unsigned long connection) { connection_ = connection; }
+    void finish(bool ok, std::uint64_t rows = 0);
+
+private:
+    QueryKind kind_;
+    const char* sql_;
+    unsigned long connection_;
+    std::chrono::steady_clock::time_point started_;
+    bool finished_ = false;
+};
+
+#endif // QUERY_STATS_H
@@ -0,0 +1,258 @@
+#include "search_index.h"
+#include <algorithm>
+#include <cmath>
+#include <unordered_set>
+
+namespace {
+
+// Параметры BM25: насыщение частоты слова и нормировка по длине документа
+constexpr double K1 = 1.2;
+constexpr double B = 0.75;
+// Совпадение в названии важнее совпадения в описании
+constexpr std::uint32_t NAME_WEIGHT = 3;
+// Более длинные "слова" обрезаются: это обычно ссылки или мусор, а не то, что ищут
+constexpr std::size_t MAX_TOKEN_BYTES = 64;
+constexpr std::size_t MAX_QUERY_TERMS = 16;
+
+constexpr std::uint32_t INVALID = 0xFFFFFFFF;
+
+// Декодирует символ UTF-8 с позиции i и сдвигает i. Некорректный байт пропускается и даёт INVALID
+std::uint32_t next_code_point(const std::string& text, std::size_t& i) {
+    auto byte = [&text](std::size_t at) { return static_cast<unsigned char>(text[at]); };
+    unsigned char lead = byte(i);
+    std::size_t length = lead < 0x80 ? 1 : (lead >> 5) == 0x6 ? 2 : (lead >> 4) == 0xE ? 3 : (lead >> 3) == 0x1E ? 4 : 0;
+    if (length == 0 || i + length > text.size()) {
+        ++i;
+        return INVALID;
+    }
+
+    std::uint32_t code = length == 1 ? lead : lead & (0xFF >> (length + 1));
+    for (std::size_t k = 1; k < length; ++k) {
+        if ((byte(i + k) & 0xC0) != 0x80) {
+            ++i;
+            return INVALID;
+        }
+        code = (code << 6) | (byte(i + k) & 0x3F);
+    }
+    i += length;
+    return code;
+}
+
+void append_utf8(std::string& out, std::uint32_t code) {
+    if (code < 0x80) {
+        out += static_cast<char>(code);
+    } else if (code < 0x800) {
+        out += static_cast<char>(0xC0 | (code >> 6));
+        out += static_cast<char>(0x80 | (code & 0x3F));
+    } else if (code < 0x10000) {
+        out += static_cast<char>(0xE0 | (code >> 12));
+        out += static_cast<char>(0x80 | ((code >> 6) & 0x3F));
+        out += static_cast<char>(0x80 | (code & 0x3F));
+    } else {
+        out += static_cast<char>(0xF0 | (code >> 18));
+        out += static_cast<char>(0x80 | ((code >> 12) & 0x3F));
+        out += static_cast<char>(0x80 | ((code >> 6) & 0x3F));
+        out += static_cast<char>(0x80 | (code & 0x3F));
+    }
+}
+
+// Символ слова в нижнем регистре; INVALID - разделитель
+std::uint32_t fold(std::uint32_t code) {
+    if (code < 0x80) {
+        if (code >= 'A' && code <= 'Z') return code + 0x20;
+        if ((code >= 'a' && code <= 'z') || (code >= '0' && code <= '9')) return code;
+        return INVALID;
+    }
+    // Latin-1: буквы без знаков умножения и деления
+    if (code >= 0xC0 && code <= 0xFF && code != 0xD7 && code != 0xF7) {
+        return code <= 0xDE ? code + 0x20 : code;
+    }
+    // Латиница Extended-A: пары заглавная/строчная, в двух отрезках заглавная нечётная
+    if ((code >= 0x139 && code <= 0x148) || (code >= 0x179 && code <= 0x17E)) {
+        return code % 2 ? code + 1 : code;
+    }
+    if (code >= 0x100 && code <= 0x17F) {
+        return code == 0x138 || code == 0x149 || code == 0x17F ? code : code | 1;
+    }
+    if (code == 0x401 || code == 0x451) return 0x435; // ё -> е
+    if (code >= 0x400 && code <= 0x40F) return code + 0x50;
+    if (code >= 0x410 && code <= 0x42F) return code + 0x20;
+    if (code >= 0x430 && code <= 0x45F) return code;
+    // Расширенная кириллица: пары заглавная/строчная, в блоке 04C1-04CE заглавная нечётная
+    if ((code >= 0x460 && code <= 0x481) || (code >= 0x48A && code <= 0x4BF) || (code >= 0x4D0 && code <= 0x4FF)) {
+        return code | 1;
+    }
+    if (code >= 0x4C1 && code <= 0x4CE) return code % 2 ? code + 1 : code;
+    if (code == 0x4C0) return 0x4CF;
+    if (code >= 0x482 && code <= 0x489) return INVALID;
+    if (code == 0x4CF) return code;
+    return INVALID;
+}
+
+template <typename Callback>
+void for_each_token(const std::string& text, Callback&& callback) {
+    std::string token;
+    token.reserve(MAX_TOKEN_BYTES + 4);
+    for (std::size_t i = 0; i < text.size();) {
+        std::uint32_t folded;
+        auto byte = static_cast<unsigned char>(text[i]);
+        if (byte < 0x80) {
+            // ASCII без декодирования UTF-8
+            ++i;
+            folded = fold(byte);
+        } else {
+            std::uint32_t code = next_code_point(text, i);
+            folded = code == INVALID ? INVALID : fold(code);
+        }
+        if (folded == INVALID) {
+            if (!token.empty()) {
+                callback(token);
+                token.clear();
+            }
+            continue;
+        }
+        if (token.size() < MAX_TOKEN_BYTES) {
+            append_utf8(token, folded);
+        }
+    }
+    if (!token.empty()) {
+        callback(token);
+    }
+}
+
+} // namespace
+
+std::vector<std::string> search_tokens(const std::string& text) {
+    std::vector<std::string> tokens;
+    for_each_token(text, [&tokens](const std::string& token) { tokens.push_back(token); });
+    return tokens;
+}
+
+void SearchIndex::add(const std::string& name, const std::string& description) {
+    auto document = static_cast<std::uint32_t>(lengths_.size());
+
+    // Номера слов документа с весами; одинаковые складываются после сортировки
+    std::vector<std::pair<std::uint32_t, std::uint32_t>> terms;
+    auto collect = [this, &terms](std::uint32_t weight) {
+        return [this, &terms, weight](const std::string& token) {
+            // find до emplace: emplace выделяет узел даже для уже известного слова
+            auto it = dictionary_.find(token);
+            if (it == dictionary_.end()) {
+                it = dictionary_.emplace(token, static_cast<std::uint32_t>(postings_.size())).first;
+                postings_.emplace_back();
+            }
+            terms.emplace_back(it->second, weight);
+        };
+    };
+    for_each_token(name, collect(NAME_WEIGHT));
+    for_each_token(description, collect(1));
+
+    std::sort(terms.begin(), terms.end());
+    std::uint32_t length = 0;
+    for (std::size_t i = 0; i < terms.size();) {
+        std::uint32_t frequency = 0;
+        std::size_t j = i;
+        for (; j < terms.size() && terms[j].first == terms[i].first; ++j) {
+            frequency += terms[j].second;
+        }
+        postings_[terms[i].first].push_back({document, frequency});
+        length += frequency;
+        i = j;
+    }
+    lengths_.push_back(length);
+}
+
+void SearchIndex::finalize() {
+    double total = 0;
+    for (auto length : lengths_) {
+        total += length;
+    }
+    double average = lengths_.empty() ? 0 : total / static_cast<double>(lengths_.size());
+    // Нормировка BM25 по длине зависит только от документа, считаем её один раз
+    norms_.reserve(lengths_.size());
+    for (auto length : lengths_) {
+        norms_.push_back(average > 0 ? K1 * (1.0 - B + B * length / average) : K1);
+    }
+    lengths_.clear();
+    lengths_.shrink_to_fit();
+    for (auto& postings : postings_) {
+        postings.shrink_to_fit();
+    }
+}
+
+SearchIndex::Result SearchIndex::search(const std::string& query, std::size_t limit) const {
+    Result result;
+    if (norms_.empty()) {
+        return result;
+    }
+
+    // Повтор слова в запросе не должен удваивать его вклад
+    std::unordered_set<std::uint32_t> query_terms;
+    for_each_token(query, [this, &query_terms](const std::string& token) {
+        if (query_terms.size() >= MAX_QUERY_TERMS) {
+            return;
+        }
+        auto it = dictionary_.find(token);
+        if (it != dictionary_.end()) {
+            query_terms.insert(it->second);
+        }
+    });
+    if (query_terms.empty()) {
+        return result;
+    }
+
+    // Списки документов отсортированы, поэтому сливаем их, а не копим оценки в хэш-таблице
+    struct Cursor {
+        const Posting* current;
+        const Posting* end;
+        double idf;
+    };
+    std::vector<Cursor> cursors;
+    const double documents = static_cast<double>(norms_.size());
+    for (auto term : query_terms) {
+        const auto& postings = postings_[term];
+        double frequency = static_cast<double>(postings.size());
+        double idf = std::log(1.0 + (documents - frequency + 0.5) / (frequency + 0.5));
+        cursors.push_back({postings.data(), postings.data() + postings.size(), idf});
+    }
+
+    auto better = [](const Hit& a, const Hit& b) {
+        return a.score != b.score ? a.score > b.score : a.document < b.document;
+    };
+    // Куча из limit лучших совпадений, на вершине - худшее из них
+    std::vector<Hit>& heap = result.hits;
+    heap.reserve(limit);
+    while (true) {
+        std::uint32_t document = INVALID;
+        for (const auto& cursor : cursors) {
+            if (cursor.current != cursor.end) {
+                document = std::min(document, cursor.current->document);
+            }
+        }
+        if (document == INVALID) {
+            break;
+        }
+
+        double score = 0;
+        for (auto& cursor : cursors) {
+            if (cursor.current != cursor.end && cursor.current->document == document) {
+                double tf = cursor.current->frequency;
+                score += cursor.idf * tf * (K1 + 1.0) / (tf + norms_[document]);
+                ++cursor.current;
+            }
+        }
+        ++result.total;
+
+        Hit hit{document, score};
+        if (heap.size() < limit) {
+            heap.push_back(hit);
+            std::push_heap(heap.begin(), heap.end(), better);
+        } else if (limit > 0 && better(hit, heap.front())) {
+            std::pop_heap(heap.begin(), heap.end(), better);
+            heap.back() = hit;
+            std::push_heap(heap.begin(), heap.end(), better);
+        }
+    }
+    std::sort_heap(heap.begin(), heap.end(), better);
+    return result;
+}
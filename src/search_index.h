@@ -0,0 +1,55 @@
+#ifndef SEARCH_INDEX_H
+#define SEARCH_INDEX_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Разбивает текст UTF-8 на слова (буквы и цифры) и приводит их к нижнему регистру.
+// Регистр сворачивается для латиницы, Latin-1 и кириллицы, "ё" ищется как "е"
+std::vector<std::string> search_tokens(const std::string& text);
+
+// Обратный индекс по названию и описанию модов с ранжированием BM25.
+// Строится один раз на снимок каталога и дальше только читается, поэтому без блокировок.
+// Документы - позиции модов в снимке, в порядке добавления
+class SearchIndex {
+public:
+    struct Hit {
+        std::uint32_t document;
+        double score;
+    };
+
+    struct Result {
+        // Лучшие совпадения по убыванию оценки, при равенстве - по позиции
+        std::vector<Hit> hits;
+        // Сколько документов совпало хотя бы по одному слову
+        std::size_t total = 0;
+    };
+
+    // Добавляет следующий документ; вызывать до finalize()
+    void add(const std::string& name, const std::string& description);
+    void finalize();
+
+    Result search(const std::string& query, std::size_t limit) const;
+
+    std::size_t documents() const { return norms_.size(); }
+    std::size_t terms() const { return postings_.size(); }
+
+private:
+    struct Posting {
+        std::uint32_t document;
+        // Взвешенная частота: слово в названии считается за NAME_WEIGHT вхождений
+        std::uint32_t frequency;
+    };
+
+    std::unordered_map<std::string, std::uint32_t> dictionary_;
+    std::vector<std::vector<Posting>> postings_;
+    // Взвешенная длина каждого документа в словах; после finalize() не нужна
+    std::vector<std::uint32_t> lengths_;
+    // K1 * (1 - B + B * длина / средняя длина) для каждого документа
+    std::vector<float> norms_;
+};
+
+#endif // SEARCH_INDEX_H
@@ -1,5 +1,7 @@
 #include "server.h"
+#include "mod_json.h"
 #include "logger.h"
+#include "query_stats.h"
 #include <iostream>
 #include <nlohmann/json.hpp>
 #include <chrono>
@@ -8,6 +10,9 @@
 #include <sstream>
 #include <thread>
 #include <mutex>
+#include <algorithm>
+#include <cctype>
+#include <limits>
 
 using json = nlohmann::json;
 
@@ -28,8 +33,8 @@ std::string get_current_time() {
     return ss.str();
 }
 
-Session::Session(boost::asio::ip::tcp::socket socket, Database& db)
-    : socket_(std::move(socket)), db_(db) {
+Session::Session(boost::asio::ip::tcp::socket socket, ModService& service)
+    : socket_(std::move(socket)), service_(service) {
 }
 
 void Session::start() {
@@ -46,36 +51,40 @@ void Session::read_request() {
         '\n',
         [this, self](boost::system::error_code ec, std::size_t length) {
             if (!ec) {
-                std::string command;
+                std::string command_line;
                 std::istream is(&request_buffer_);
-                std::getline(is, command);
+                std::getline(is, command_line);
                 
-                log_message("Received command: " + command, "DEBUG");
+                log_message("Received command: " + command_line, "DEBUG");
+
+                // После имени команды через пробел могут идти параметры, например fields=id,name
+                std::string command = command_line.substr(0, command_line.find(' '));
+                std::string options = command.size() < command_line.size() ? command_line.substr(command.size() + 1) : "";
                 
                 // Проверяем, требует ли команда дополнительных данных
-                if (command == "GET_MOD_BY_ID") {
+                if (command_has_data(command)) {
                     // Если команда требует данных, читаем следующую строку
                     boost::asio::async_read_until(
                         socket_,
                         request_buffer_,
                         '\n',
-                        [this, self, command](boost::system::error_code ec2, std::size_t length2) {
+                        [this, self, command, options](boost::system::error_code ec2, std::size_t length2) {
                             if (!ec2) {
                                 std::string data;
                                 std::istream is2(&request_buffer_);
                                 std::getline(is2, data);
                                 
                                 log_message("Received data for command: '" + data + "'", "DEBUG");
-                                handle_command(command, data);
+                                handle_command(command, options, data);
                             } else {
                                 // Обработка ошибок при чтении данных
                                 log_message("Error reading command data: " + ec2.message(), "ERROR");
-                                handle_command(command, ""); // Пустые данные
+                                handle_command(command, options, ""); // Пустые данные
                             }
                         });
                 } else {
                     // Если команда не требует данных, обрабатываем ее сразу
-                    handle_command(command, "");
+                    handle_command(command, options, "");
                 }
             } else {
                 // Если клиент отключился или произошла ошибка
@@ -97,16 +106,29 @@ void Session::read_request() {
 }
 
 void Session::send_response(const std::string& response) {
-    auto self(shared_from_this());
-    
     log_message("Sending response: '" + response + "'", "DEBUG");
     
-    std::string full_response = response + "\n";
-    
+    write_response(std::make_shared<const std::string>(response + "\n"));
+}
+
+void Session::write_response(std::shared_ptr<const std::string> full_response) {
+    write_response(ResponseParts{std::move(full_response)});
+}
+
+void Session::write_response(ResponseParts parts) {
+    auto self(shared_from_this());
+
+    std::vector<boost::asio::const_buffer> buffers;
+    buffers.reserve(parts.size());
+    for (const auto& part : parts) {
+        buffers.push_back(boost::asio::buffer(*part));
+    }
+
+    // Куски должны жить до завершения async_write, поэтому держим их в обработчике
     boost::asio::async_write(
         socket_,
-        boost::asio::buffer(full_response),
-        [this, self](boost::system::error_code ec, std::size_t /*length*/) {
+        buffers,
+        [this, self, parts = std::move(parts)](boost::system::error_code ec, std::size_t /*length*/) {
             if (!ec) {
                 log_message("Response sent successfully", "DEBUG");
                 // Очищаем буфер перед чтением следующего запроса
@@ -123,8 +145,55 @@ void Session::send_response(const std::string& response) {
         });
 }
 
-void Session::handle_command(const std::string& command, const std::string& data) {
+bool Session::command_has_data(const std::string& command) {
+    // Эти команды передают параметры отдельной строкой после имени команды
+    return command == "GET_MOD_BY_ID" || command == "GET_MODS_PAGE" || command == "GET_MODS_BY_IDS" ||
+           command == "GET_MODS_BY_CATEGORY" || command == "SEARCH" ||
+           command == "ADD_MOD" || command == "UPDATE_MOD" || command == "DELETE_MOD" ||
+           command == "RECORD_DOWNLOAD" || command == "RECORD_VIEW";
+}
+
+bool Session::parse_options(const std::string& command, const std::string& options) {
+    fields_ = DEFAULT_FIELDS;
+    search_limit_ = DEFAULT_SEARCH_RESULTS;
+
+    std::istringstream params(options);
+    std::string option;
+    while (params >> option) {
+        if (option.compare(0, 7, "fields=") == 0) {
+            auto fields = parse_field_list(option.substr(7));
+            if (!fields) {
+                send_response("ERROR: Unknown field in '" + option + "'");
+                return false;
+            }
+            fields_ = *fields;
+        } else if (command == "SEARCH" && option.compare(0, 6, "limit=") == 0) {
+            std::size_t parsed = 0;
+            long long limit = 0;
+            try {
+                limit = std::stoll(option.substr(6), &parsed);
+            } catch (const std::exception&) {
+                parsed = 0;
+            }
+            if (parsed == 0 || parsed != option.size() - 6 || limit <= 0) {
+                send_response("ERROR: Invalid limit in '" + option + "'");
+                return false;
+            }
+            search_limit_ = static_cast<std::size_t>(std::min(limit, MAX_SEARCH_RESULTS));
+        } else {
+            send_response("ERROR: Unknown option '" + option + "'");
+            return false;
+        }
+    }
+    return true;
+}
+
+void Session::handle_command(const std::string& command, const std::string& options, const std::string& data) {
     log_message("Received command: " + command, "INFO");
+
+    if (!parse_options(command, options)) {
+        return;
+    }
     
     if (command == "PING") {
         send_response("PONG");
@@ -132,37 +201,270 @@ void Session::handle_command(const std::string& command, const std::string& data
         handle_get_all_mods();
     } else if (command == "GET_MOD_BY_ID") {
         handle_get_mod_by_id(data);
+    } else if (command == "GET_MODS_PAGE") {
+        handle_get_mods_page(data);
+    } else if (command == "GET_MODS_BY_IDS") {
+        handle_get_mods_by_ids(data);
+    } else if (command == "GET_MODS_BY_CATEGORY") {
+        handle_get_mods_by_category(data);
+    } else if (command == "GET_CATEGORIES") {
+        handle_get_categories();
+    } else if (command == "SEARCH") {
+        handle_search(data);
+    } else if (command == "ADD_MOD" || command == "UPDATE_MOD" || command == "DELETE_MOD") {
+        handle_write(command, data);
+    } else if (command == "RECORD_DOWNLOAD" || command == "RECORD_VIEW") {
+        handle_record_counter(command, data);
+    } else if (command == "GET_DB_STATS") {
+        handle_get_db_stats();
     } else {
         log_message("Unknown command received: " + command, "WARNING");
         send_response("ERROR: Unknown command");
     }
 }
 
-void Session::handle_get_all_mods() {
+void Session::handle_record_counter(const std::string& command, const std::string& data) {
+    std::size_t parsed = 0;
+    long long mod_id = -1;
     try {
-        log_message("Начинаем обработку запроса GET_ALL_MODS", "DEBUG");
-        auto mods = db_.getAllMods();
-        
-        log_message("Получено " + std::to_string(mods.size()) + " модов из базы данных", "DEBUG");
-        
-        nlohmann::json json_response = nlohmann::json::array();
-        for (const auto& mod : mods) {
-            json_response.push_back({
-                {"id", mod.id},
-                {"name", mod.name},
-                {"description", mod.description},
-                {"link", mod.link},
-                {"media", mod.media_links},
-                {"category", mod.category}
-            });
-        }
-        
-        log_message("JSON ответ сформирован, размер: " + std::to_string(json_response.dump().size()) + " байт", "DEBUG");
-        send_response(json_response.dump());
-    } catch (const std::exception& e) {
-        log_message("Error in handle_get_all_mods: " + std::string(e.what()), "ERROR");
-        send_response("[]");
+        mod_id = std::stoll(data, &parsed);
+    } catch (const std::exception&) {
+        parsed = 0;
+    }
+    if (parsed == 0 || data.find_first_not_of(" \r\t", parsed) != std::string::npos ||
+        mod_id <= 0 || mod_id > std::numeric_limits<int>::max()) {
+        log_message("Некорректный id в " + command + ": '" + data + "'", "WARNING");
+        send_response("ERROR: Invalid mod ID");
+        return;
+    }
+
+    // Только счётчик в памяти, ответ не ждёт MySQL
+    auto kind = command == "RECORD_DOWNLOAD" ? ModCounters::Kind::Download : ModCounters::Kind::View;
+    if (!service_.recordCounter(static_cast<int>(mod_id), kind)) {
+        send_response("ERROR: Mod not found");
+        return;
+    }
+    send_response("OK");
+}
+
+void Session::handle_get_db_stats() {
+    // Статистика копится в памяти процесса, в БД за ней не ходим
+    json stats = query_stats().toJson();
+    stats["circuit_breaker"] = service_.breakerState();
+    send_response(stats.dump());
+}
+
+void Session::handle_get_all_mods() {
+    log_message("Начинаем обработку запроса GET_ALL_MODS", "DEBUG");
+
+    // Основной путь: готовый ответ из текущего снимка каталога, без обращения к MySQL
+    auto snapshot = service_.catalog();
+    if (snapshot) {
+        send_catalog(snapshot);
+        return;
+    }
+
+    // Снимок ещё не загружен - загружаем его (один раз на все ожидающие сессии)
+    auto self(shared_from_this());
+    bool queued = service_.loadCatalog(socket_.get_executor(),
+        [this, self](const ModService::SnapshotResult& loaded) {
+            send_catalog(loaded);
+        });
+
+    if (!queued) {
+        send_response("ERROR: Server busy");
+    }
+}
+
+void Session::send_catalog(const ModService::SnapshotResult& snapshot) {
+    if (!snapshot) {
+        // Пустой массив клиент принял бы за пустой каталог, а каталога просто нет
+        log_message("Не удалось загрузить моды из базы данных", "ERROR");
+        send_response("ERROR: Database unavailable");
+        return;
+    }
+
+    log_message("Отдаём каталог из снимка v" + std::to_string(snapshot->version) + ", размер: " +
+                std::to_string(snapshot->all_mods_bytes) + " байт", "DEBUG");
+    if (service_.catalogStale()) {
+        // Формат GET_ALL_MODS - голый массив, пометку stale в него не добавить без поломки клиентов.
+        // Переход автомата защиты в разомкнутое состояние уже залогирован как WARNING,
+        // здесь на каждый запрос - только DEBUG, иначе при сбое лог растёт со скоростью запросов
+        log_message("База данных недоступна, каталог может быть устаревшим", "DEBUG");
+    }
+    write_response(snapshot->allModsResponse(fields_));
+}
+
+void Session::handle_get_mods_page(const std::string& data) {
+    // Формат данных: "<последний полученный id> [размер страницы]", первая страница - с курсором 0
+    std::istringstream params(data);
+    long long after_id = 0;
+    long long limit = DEFAULT_PAGE_SIZE;
+    if (!(params >> after_id)) {
+        log_message("Некорректный курсор GET_MODS_PAGE: '" + data + "'", "WARNING");
+        send_response("ERROR: Invalid page cursor");
+        return;
+    }
+    if (!(params >> limit)) {
+        limit = DEFAULT_PAGE_SIZE;
+    }
+    if (after_id < 0 || after_id > std::numeric_limits<int>::max() || limit <= 0) {
+        send_response("ERROR: Invalid page cursor");
+        return;
+    }
+    std::size_t page_size = static_cast<std::size_t>(std::min<long long>(limit, MAX_PAGE_SIZE));
+
+    auto snapshot = service_.catalog();
+    if (snapshot) {
+        send_mods_page(snapshot, static_cast<int>(after_id), page_size);
+        return;
+    }
+
+    auto self(shared_from_this());
+    bool queued = service_.loadCatalog(socket_.get_executor(),
+        [this, self, after_id, page_size](const ModService::SnapshotResult& loaded) {
+            send_mods_page(loaded, static_cast<int>(after_id), page_size);
+        });
+
+    if (!queued) {
+        send_response("ERROR: Server busy");
+    }
+}
+
+void Session::send_mods_page(const ModService::SnapshotResult& snapshot, int after_id, std::size_t limit) {
+    if (!snapshot) {
+        log_message("Не удалось загрузить моды из базы данных", "ERROR");
+        send_response("ERROR: Catalog unavailable");
+        return;
+    }
+
+    log_message("Страница каталога после id " + std::to_string(after_id) + ", до " +
+                std::to_string(limit) + " модов (снимок v" + std::to_string(snapshot->version) + ")", "DEBUG");
+    write_response(std::make_shared<const std::string>(
+        snapshot->pageResponse(after_id, limit, service_.catalogStale(), fields_)));
+}
+
+void Session::handle_get_mods_by_category(const std::string& data) {
+    // Формат данных: "<категория>" для первой страницы или "<последний полученный id> <размер страницы> <категория>"
+    std::string category = data;
+    long long after_id = 0;
+    long long limit = DEFAULT_PAGE_SIZE;
+    std::istringstream params(data);
+    long long cursor = 0;
+    long long page = 0;
+    if (params >> cursor >> page && std::isspace(params.peek())) {
+        std::getline(params >> std::ws, category);
+        after_id = cursor;
+        limit = page;
+    }
+    category.erase(category.find_last_not_of(" \r\t") + 1);
+    category.erase(0, category.find_first_not_of(" \t"));
+    if (category.empty()) {
+        send_response("ERROR: Empty category");
+        return;
+    }
+    if (after_id < 0 || after_id > std::numeric_limits<int>::max() || limit <= 0) {
+        send_response("ERROR: Invalid page cursor");
+        return;
+    }
+    std::size_t page_size = static_cast<std::size_t>(std::min<long long>(limit, MAX_PAGE_SIZE));
+
+    auto snapshot = service_.catalog();
+    if (snapshot) {
+        send_category_page(snapshot, category, static_cast<int>(after_id), page_size);
+        return;
+    }
+
+    auto self(shared_from_this());
+    bool queued = service_.loadCatalog(socket_.get_executor(),
+        [this, self, category, after_id, page_size](const ModService::SnapshotResult& loaded) {
+            send_category_page(loaded, category, static_cast<int>(after_id), page_size);
+        });
+
+    if (!queued) {
+        send_response("ERROR: Server busy");
+    }
+}
+
+void Session::send_category_page(const ModService::SnapshotResult& snapshot, const std::string& category,
+                                 int after_id, std::size_t limit) {
+    if (!snapshot) {
+        log_message("Не удалось загрузить моды из базы данных", "ERROR");
+        send_response("ERROR: Catalog unavailable");
+        return;
+    }
+
+    log_message("Категория '" + category + "' после id " + std::to_string(after_id) + ", до " +
+                std::to_string(limit) + " модов (снимок v" + std::to_string(snapshot->version) + ")", "DEBUG");
+    write_response(std::make_shared<const std::string>(
+        snapshot->categoryPageResponse(category, after_id, limit, service_.catalogStale(), fields_)));
+}
+
+void Session::handle_get_categories() {
+    auto snapshot = service_.catalog();
+    if (snapshot) {
+        send_categories(snapshot);
+        return;
+    }
+
+    auto self(shared_from_this());
+    bool queued = service_.loadCatalog(socket_.get_executor(),
+        [this, self](const ModService::SnapshotResult& loaded) {
+            send_categories(loaded);
+        });
+
+    if (!queued) {
+        send_response("ERROR: Server busy");
+    }
+}
+
+void Session::send_categories(const ModService::SnapshotResult& snapshot) {
+    if (!snapshot) {
+        log_message("Не удалось загрузить моды из базы данных", "ERROR");
+        send_response("ERROR: Catalog unavailable");
+        return;
     }
+
+    write_response(std::make_shared<const std::string>(snapshot->categoriesResponse(service_.catalogStale())));
+}
+
+void Session::handle_search(const std::string& data) {
+    std::string query = data;
+    query.erase(query.find_last_not_of(" \r\t") + 1);
+    query.erase(0, query.find_first_not_of(" \t"));
+    if (query.empty()) {
+        send_response("ERROR: Empty search query");
+        return;
+    }
+
+    auto snapshot = service_.catalog();
+    if (snapshot) {
+        send_search(snapshot, query);
+        return;
+    }
+
+    auto self(shared_from_this());
+    bool queued = service_.loadCatalog(socket_.get_executor(),
+        [this, self, query](const ModService::SnapshotResult& loaded) {
+            send_search(loaded, query);
+        });
+
+    if (!queued) {
+        send_response("ERROR: Server busy");
+    }
+}
+
+void Session::send_search(const ModService::SnapshotResult& snapshot, const std::string& query) {
+    if (!snapshot) {
+        log_message("Не удалось загрузить моды из базы данных", "ERROR");
+        send_response("ERROR: Catalog unavailable");
+        return;
+    }
+
+    log_message("Поиск '" + query + "', до " + std::to_string(search_limit_) + " модов (снимок v" +
+                std::to_string(snapshot->version) + ")", "DEBUG");
+    write_response(std::make_shared<const std::string>(
+        snapshot->searchResponse(query, search_limit_, service_.catalogStale(), fields_)));
 }
 
 void Session::handle_get_mod_by_id(const std::string& data) {
@@ -184,28 +486,57 @@ void Session::handle_get_mod_by_id(const std::string& data) {
             return;
         }
         
-        // Получаем ID мода из данных запроса
-        int mod_id = std::stoi(clean_data);
+        // Получаем ID мода из данных запроса: только положительное число без посторонних символов
+        std::size_t parsed = 0;
+        long long requested_id = -1;
+        try {
+            requested_id = std::stoll(clean_data, &parsed);
+        } catch (const std::exception&) {
+            parsed = 0;
+        }
+        if (parsed != clean_data.size() || requested_id <= 0 || requested_id > std::numeric_limits<int>::max()) {
+            log_message("Некорректный id в GET_MOD_BY_ID: '" + clean_data + "'", "WARNING");
+            send_response("ERROR: Invalid mod ID");
+            return;
+        }
+        int mod_id = static_cast<int>(requested_id);
         log_message("Запрошен мод с ID: " + std::to_string(mod_id), "DEBUG");
         
-        // Получаем данные мода из базы данных
-        auto mod = db_.getModById(mod_id);
-        
-        if (!mod) {
+        // Запрос к базе выполняется в пуле БД, ответ придёт обратно на наш executor
+        auto self(shared_from_this());
+        bool queued = service_.getModById(mod_id, socket_.get_executor(),
+            [this, self, mod_id](const ModService::ModResult& mod) {
+                send_mod(mod_id, mod);
+            });
+
+        if (!queued) {
+            send_response("ERROR: Server busy");
+        }
+    }
+    catch (const std::exception& e) {
+        log_message("Ошибка при обработке GET_MOD_BY_ID: " + std::string(e.what()), "ERROR");
+        send_response("ERROR: " + std::string(e.what()));
+    }
+}
+
+void Session::send_mod(int mod_id, const ModService::ModResult& lookup) {
+    try {
+        if (lookup.status == ModLookup::Status::Unavailable) {
+            log_message("База данных недоступна, мод с ID " + std::to_string(mod_id) + " не получен", "WARNING");
+            send_response("ERROR: Database unavailable");
+            return;
+        }
+        if (lookup.status == ModLookup::Status::NotFound) {
             log_message("Мод с ID " + std::to_string(mod_id) + " не найден", "WARNING");
             send_response("ERROR: Mod not found");
             return;
         }
         
         // Формируем JSON-ответ
-        nlohmann::json json_response = {
-            {"id", mod->id},
-            {"name", mod->name},
-            {"description", mod->description},
-            {"link", mod->link},
-            {"media", mod->media_links},
-            {"category", mod->category}
-        };
+        nlohmann::json json_response = mod_to_json(*lookup.mod, fields_);
+        if (lookup.stale) {
+            json_response["stale"] = true;
+        }
         
         log_message("Отправляем данные мода с ID " + std::to_string(mod_id), "INFO");
         send_response(json_response.dump());
@@ -216,10 +547,81 @@ void Session::handle_get_mod_by_id(const std::string& data) {
     }
 }
 
-Server::Server(boost::asio::io_context& io_context, short port, Database& db)
+void Session::handle_get_mods_by_ids(const std::string& data) {
+    // Формат данных: id через запятую и/или пробел, например "12,15 42"
+    std::string normalized = data;
+    std::replace(normalized.begin(), normalized.end(), ',', ' ');
+    std::istringstream params(normalized);
+
+    std::vector<int> mod_ids;
+    std::string token;
+    while (params >> token) {
+        std::size_t parsed = 0;
+        long long mod_id = -1;
+        try {
+            mod_id = std::stoll(token, &parsed);
+        } catch (const std::exception&) {
+            parsed = 0;
+        }
+        if (parsed != token.size() || mod_id <= 0 || mod_id > std::numeric_limits<int>::max()) {
+            log_message("Некорректный id в GET_MODS_BY_IDS: '" + token + "'", "WARNING");
+            send_response("ERROR: Invalid mod ID list");
+            return;
+        }
+        mod_ids.push_back(static_cast<int>(mod_id));
+    }
+
+    if (mod_ids.empty()) {
+        send_response("ERROR: Empty mod ID list");
+        return;
+    }
+    if (mod_ids.size() > MAX_BATCH_IDS) {
+        send_response("ERROR: Too many mod IDs (max " + std::to_string(MAX_BATCH_IDS) + ")");
+        return;
+    }
+
+    log_message("Запрошено модов по списку: " + std::to_string(mod_ids.size()), "DEBUG");
+    auto self(shared_from_this());
+    bool queued = service_.getModsByIds(mod_ids, socket_.get_executor(),
+        [this, self, mod_ids](const ModService::BatchResult& results) {
+            send_mods_batch(mod_ids, results);
+        });
+
+    if (!queued) {
+        send_response("ERROR: Server busy");
+    }
+}
+
+void Session::send_mods_batch(const std::vector<int>& mod_ids, const ModService::BatchResult& results) {
+    // Ответ - массив в порядке запроса; для ненайденных id - объект с полем error
+    nlohmann::json response = nlohmann::json::array();
+    std::size_t found = 0;
+    for (std::size_t i = 0; i < mod_ids.size() && i < results.size(); ++i) {
+        const auto& lookup = results[i];
+        if (lookup.status == ModLookup::Status::Found) {
+            nlohmann::json mod = mod_to_json(*lookup.mod, fields_);
+            if (lookup.stale) {
+                mod["stale"] = true;
+            }
+            response.push_back(std::move(mod));
+            ++found;
+        } else {
+            response.push_back({
+                {"id", mod_ids[i]},
+                {"error", lookup.status == ModLookup::Status::NotFound ? "not_found" : "unavailable"}
+            });
+        }
+    }
+
+    log_message("Отправляем " + std::to_string(found) + " из " + std::to_string(mod_ids.size()) +
+                " запрошенных модов", "INFO");
+    send_response(response.dump());
+}
+
+Server::Server(boost::asio::io_context& io_context, short port, ModService& service)
     : io_context_(io_context)
     , acceptor_(io_context, boost::asio::ip::tcp::endpoint(boost::asio::ip::tcp::v4(), port))
-    , db_(db) {
+    , service_(service) {
     log_message("Server started on port " + std::to_string(port), "INFO");
     do_accept();
 }
@@ -233,7 +635,7 @@ void Server::do_accept() {
                                             ":" + std::to_string(socket.remote_endpoint().port());
                     log_message("New client connected: " + client_info, "INFO");
                     
-                    auto session = std::make_shared<Session>(std::move(socket), db_);
+                    auto session = std::make_shared<Session>(std::move(socket), service_);
                     session->start();
                 } catch (const std::exception& e) {
                     log_message("Error accepting connection: " + std::string(e.what()), "ERROR");
@@ -245,4 +647,138 @@ void Server::do_accept() {
             // Продолжаем принимать новые соединения
             do_accept();
         });
-} 
\ No newline at end of file
+} 
+
+std::optional<ModWrite> Session::parse_mod_write(ModWrite::Op op, const std::string& data, std::string& error) {
+    ModWrite write;
+    write.op = op;
+
+    // DELETE_MOD передаёт только id
+    if (op == ModWrite::Op::Delete) {
+        std::size_t parsed = 0;
+        long long mod_id = -1;
+        try {
+            mod_id = std::stoll(data, &parsed);
+        } catch (const std::exception&) {
+            parsed = 0;
+        }
+        if (parsed == 0 || data.find_first_not_of(" \r\t", parsed) != std::string::npos ||
+            mod_id <= 0 || mod_id > std::numeric_limits<int>::max()) {
+            error = "Invalid mod ID";
+            return std::nullopt;
+        }
+        write.id = static_cast<int>(mod_id);
+        return write;
+    }
+
+    json object = json::parse(data, nullptr, false);
+    if (!object.is_object()) {
+        error = "Expected JSON object";
+        return std::nullopt;
+    }
+
+    for (auto it = object.begin(); it != object.end(); ++it) {
+        const std::string& key = it.key();
+        const json& value = it.value();
+        if (key == "id") {
+            if (!value.is_number_integer() || value.get<long long>() <= 0 ||
+                value.get<long long>() > std::numeric_limits<int>::max()) {
+                error = "Invalid mod ID";
+                return std::nullopt;
+            }
+            write.id = value.get<int>();
+        } else if (key == "media_links") {
+            if (!value.is_array()) {
+                error = "Field 'media_links' must be an array of strings";
+                return std::nullopt;
+            }
+            std::vector<std::string> links;
+            for (const auto& link : value) {
+                if (!link.is_string()) {
+                    error = "Field 'media_links' must be an array of strings";
+                    return std::nullopt;
+                }
+                links.push_back(link.get<std::string>());
+            }
+            write.media_links = std::move(links);
+        } else if (key == "name" || key == "description" || key == "link" || key == "category") {
+            if (!value.is_string()) {
+                error = "Field '" + key + "' must be a string";
+                return std::nullopt;
+            }
+            std::optional<std::string>& field = key == "name" ? write.name
+                                              : key == "description" ? write.description
+                                              : key == "link" ? write.link
+                                              : write.category;
+            field = value.get<std::string>();
+        } else {
+            error = "Unknown field '" + key + "'";
+            return std::nullopt;
+        }
+    }
+
+    if (op == ModWrite::Op::Update && write.id == 0) {
+        error = "Missing mod ID";
+        return std::nullopt;
+    }
+    if (op == ModWrite::Op::Add && (!write.name || write.name->empty())) {
+        error = "Missing mod name";
+        return std::nullopt;
+    }
+    return write;
+}
+
+void Session::handle_write(const std::string& command, const std::string& data) {
+    if (!service_.writesEnabled()) {
+        log_message("Команда записи " + command + " отклонена: запись выключена в конфигурации", "WARNING");
+        send_response("ERROR: Writes disabled");
+        return;
+    }
+
+    ModWrite::Op op = command == "ADD_MOD" ? ModWrite::Op::Add
+                    : command == "UPDATE_MOD" ? ModWrite::Op::Update
+                    : ModWrite::Op::Delete;
+    std::string error;
+    auto write = parse_mod_write(op, data, error);
+    if (!write) {
+        log_message("Некорректные данные " + command + ": " + error, "WARNING");
+        send_response("ERROR: " + error);
+        return;
+    }
+
+    auto self(shared_from_this());
+    bool queued = service_.applyWrite(std::move(*write), socket_.get_executor(),
+        [this, self, op](const ModWriteResult& result) {
+            send_write_result(op, result);
+        });
+
+    if (!queued) {
+        send_response("ERROR: Server busy");
+    }
+}
+
+void Session::send_write_result(ModWrite::Op op, const ModWriteResult& result) {
+    switch (result.status) {
+        case ModWriteResult::Status::Ok:
+            break;
+        case ModWriteResult::Status::NotFound:
+            send_response("ERROR: Mod not found");
+            return;
+        case ModWriteResult::Status::Conflict:
+            send_response("ERROR: Mod already exists");
+            return;
+        case ModWriteResult::Status::Rejected:
+            send_response("ERROR: Rejected by database");
+            return;
+        case ModWriteResult::Status::Unavailable:
+            send_response("ERROR: Database unavailable");
+            return;
+    }
+
+    log_message("Запись мода с ID " + std::to_string(result.mod.id) + " зафиксирована", "INFO");
+    if (op == ModWrite::Op::Delete) {
+        send_response(json{{"id", result.mod.id}, {"deleted", true}}.dump());
+        return;
+    }
+    send_response(mod_to_json(result.mod, fields_).dump());
+}
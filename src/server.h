@@ -5,44 +5,86 @@
 #include <memory>
 #include <functional>
 #include <array>
-#include "database.h"
+#include <optional>
+#include <vector>
+#include "mod_service.h"
+#include "mod_json.h"
 #include "logger.h"
 
 // Класс, представляющий сессию клиента
 class Session : public std::enable_shared_from_this<Session> {
 public:
-    Session(boost::asio::ip::tcp::socket socket, Database& db);
+    Session(boost::asio::ip::tcp::socket socket, ModService& service);
     
     void start();
     
 private:
     void read_request();
     void send_response(const std::string& response);
+    void write_response(std::shared_ptr<const std::string> full_response);
+    // Ответ из нескольких кусков (GET_ALL_MODS) одной записью, без склейки в одну строку
+    void write_response(ResponseParts parts);
     
     void process_data(const std::string& data);
-    void handle_command(const std::string& command, const std::string& data);
+    void handle_command(const std::string& command, const std::string& options, const std::string& data);
+    // Разбирает параметры команды (fields=..., limit=... для SEARCH); при ошибке сам отвечает клиенту
+    // и возвращает false
+    bool parse_options(const std::string& command, const std::string& options);
+    static bool command_has_data(const std::string& command);
     
     // Обработчики команд
     void handle_get_all_mods();
+    void handle_get_db_stats();
     void handle_get_mod_by_id(const std::string& data);
+    void send_catalog(const ModService::SnapshotResult& snapshot);
+    void handle_get_mods_page(const std::string& data);
+    void send_mods_page(const ModService::SnapshotResult& snapshot, int after_id, std::size_t limit);
+    // GET_MODS_BY_CATEGORY: страница модов одной категории из индекса снимка
+    void handle_get_mods_by_category(const std::string& data);
+    void send_category_page(const ModService::SnapshotResult& snapshot, const std::string& category,
+                            int after_id, std::size_t limit);
+    void handle_get_categories();
+    void send_categories(const ModService::SnapshotResult& snapshot);
+    // SEARCH: полнотекстовый поиск по названию и описанию в индексе снимка
+    void handle_search(const std::string& data);
+    void send_search(const ModService::SnapshotResult& snapshot, const std::string& query);
+    void send_mod(int mod_id, const ModService::ModResult& lookup);
+    void handle_get_mods_by_ids(const std::string& data);
+    void send_mods_batch(const std::vector<int>& mod_ids, const ModService::BatchResult& results);
+    // ADD_MOD / UPDATE_MOD (JSON-объект мода) и DELETE_MOD (id)
+    void handle_write(const std::string& command, const std::string& data);
+    // RECORD_DOWNLOAD / RECORD_VIEW (id)
+    void handle_record_counter(const std::string& command, const std::string& data);
+    void send_write_result(ModWrite::Op op, const ModWriteResult& result);
+    // Разбирает JSON записи; при ошибке возвращает nullopt и текст ошибки в error
+    static std::optional<ModWrite> parse_mod_write(ModWrite::Op op, const std::string& data, std::string& error);
     
+    static constexpr long long DEFAULT_PAGE_SIZE = 50;
+    static constexpr long long MAX_PAGE_SIZE = 500;
+    static constexpr std::size_t MAX_BATCH_IDS = 1000;
+    static constexpr long long DEFAULT_SEARCH_RESULTS = 20;
+    static constexpr long long MAX_SEARCH_RESULTS = 200;
+
     boost::asio::ip::tcp::socket socket_;
     boost::asio::streambuf request_buffer_;
     std::string incomplete_data_;
-    Database& db_; // Ссылка на базу данных
+    ModService& service_; // Доступ к данным через пул БД
+    // Поля модов в ответе на текущую команду; сессия обрабатывает команды по одной
+    FieldMask fields_ = DEFAULT_FIELDS;
+    std::size_t search_limit_ = DEFAULT_SEARCH_RESULTS;
 };
 
 // Класс, представляющий сервер
 class Server {
 public:
-    Server(boost::asio::io_context& io_context, short port, Database& db);
+    Server(boost::asio::io_context& io_context, short port, ModService& service);
     
 private:
     void do_accept();
     
     boost::asio::io_context& io_context_;
     boost::asio::ip::tcp::acceptor acceptor_;
-    Database& db_;
+    ModService& service_;
 };
 
 // Не объявляем log_message здесь, так как она уже определена в logger.h 
\ No newline at end of file
@@ -0,0 +1,67 @@
+#ifndef SINGLE_FLIGHT_H
+#define SINGLE_FLIGHT_H
+
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// Объединение одинаковых одновременных запросов (single-flight):
+// пока загрузка по ключу идёт, новые запросы с тем же ключом не запускают
+// свою, а ждут результата первой. Все ожидающие получают один общий результат.
+template <typename Key, typename Value>
+class SingleFlight {
+public:
+    using Result = std::shared_ptr<const Value>;
+    using Waiter = std::function<void(const Result&)>;
+
+    // Добавляет ожидающего к загрузке по ключу. Если загрузки ещё нет,
+    // вызывает start(), который должен её запустить (не блокируясь) и вернуть
+    // true при успехе. Возвращает false, только если start() не удался -
+    // тогда waiter не регистрируется и вызван не будет.
+    template <typename Start>
+    bool join(const Key& key, Waiter waiter, Start&& start) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = calls_.find(key);
+        if (it != calls_.end()) {
+            it->second.push_back(std::move(waiter));
+            return true;
+        }
+
+        // start() вызывается под мьютексом, поэтому complete() из другого потока
+        // не сможет завершить загрузку раньше, чем мы её зарегистрируем
+        if (!start()) {
+            return false;
+        }
+        calls_[key].push_back(std::move(waiter));
+        return true;
+    }
+
+    // Завершает загрузку по ключу и передаёт результат всем ожидающим
+    void complete(const Key& key, Value value) {
+        auto result = std::make_shared<const Value>(std::move(value));
+
+        std::vector<Waiter> waiters;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            auto it = calls_.find(key);
+            if (it == calls_.end()) {
+                return;
+            }
+            waiters = std::move(it->second);
+            calls_.erase(it);
+        }
+
+        for (auto& waiter : waiters) {
+            waiter(result);
+        }
+    }
+
+private:
+    std::mutex mutex_;
+    std::unordered_map<Key, std::vector<Waiter>> calls_;
+};
+
+#endif // SINGLE_FLIGHT_H
@@ -0,0 +1,256 @@
+#include "synthetic_storage.h"
+#include "logger.h"
+#include <thread>
+
+namespace {
+
+// Словарь для описаний: латиница и кириллица, как в реальном каталоге
+const char* const WORDS[] = {
+    "mod", "texture", "pack", "weapon", "armor", "quest", "map", "sound", "patch", "fix",
+    "realistic", "lighting", "shader", "vehicle", "skin", "overhaul", "balance", "ui", "hd", "remaster",
+    "мод", "текстуры", "оружие", "броня", "квест", "карта", "звук", "исправление", "графика", "баланс",
+    "реалистичный", "освещение", "транспорт", "интерфейс", "сборка", "локация", "персонаж", "сюжет", "погода", "русификатор"
+};
+constexpr std::size_t WORD_COUNT = sizeof(WORDS) / sizeof(WORDS[0]);
+
+const char* const CATEGORIES[] = {
+    "Graphics", "Gameplay", "Weapons", "Maps", "Audio", "Interface", "Vehicles", "Characters"
+};
+constexpr std::size_t CATEGORY_COUNT = sizeof(CATEGORIES) / sizeof(CATEGORIES[0]);
+
+} // namespace
+
+SyntheticStorage::SyntheticStorage(const SyntheticStorageOptions& options)
+    : options_(options), rng_(options.seed) {
+}
+
+std::string SyntheticStorage::generateText(std::size_t bytes) {
+    std::uniform_int_distribution<std::size_t> pick(0, WORD_COUNT - 1);
+    std::string text;
+    text.reserve(bytes + 32);
+    while (text.size() < bytes) {
+        if (!text.empty()) {
+            text += ' ';
+        }
+        text += WORDS[pick(rng_)];
+    }
+    return text;
+}
+
+ModData SyntheticStorage::generateMod(int id) {
+    std::uniform_int_distribution<std::size_t> category(0, CATEGORY_COUNT - 1);
+
+    ModData mod;
+    mod.id = id;
+    mod.name = generateText(16) + " #" + std::to_string(id);
+    mod.description = generateText(options_.description_bytes);
+    mod.link = "https://mods.example.com/mods/" + std::to_string(id);
+    mod.category = CATEGORIES[category(rng_)];
+    // Популярность с длинным хвостом: немного хитов и много почти не скачиваемых модов
+    std::uniform_real_distribution<double> popularity(0.0, 1.0);
+    double p = popularity(rng_);
+    mod.downloads = static_cast<std::uint64_t>(100000.0 * p * p * p * p);
+    mod.views = mod.downloads * 5 + static_cast<std::uint64_t>(1000.0 * p);
+    mod.media_links.reserve(options_.media_per_mod);
+    for (std::size_t i = 0; i < options_.media_per_mod; ++i) {
+        mod.media_links.push_back("https://media.example.com/" + std::to_string(id) + "/" +
+                                  std::to_string(i + 1) + ".jpg");
+    }
+    return mod;
+}
+
+bool SyntheticStorage::connect() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!mods_.empty()) {
+        return true;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    mods_.reserve(options_.mod_count);
+    revisions_.assign(options_.mod_count, 0);
+    deleted_.assign(options_.mod_count, false);
+    for (std::size_t i = 0; i < options_.mod_count; ++i) {
+        mods_.push_back(generateMod(static_cast<int>(i + 1)));
+    }
+    auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - start);
+
+    log_message("Synthetic catalog generated: " + std::to_string(mods_.size()) + " mods in " +
+                std::to_string(elapsed.count()) + " ms", "INFO");
+    return true;
+}
+
+void SyntheticStorage::simulateLatency() const {
+    if (options_.latency.count() > 0) {
+        std::this_thread::sleep_for(options_.latency);
+    }
+}
+
+bool SyntheticStorage::streamAllMods(const ModConsumer& consume) {
+    simulateLatency();
+
+    // Копируем под блокировкой и отдаём без неё, чтобы consume не держал мьютекс
+    std::vector<ModData> mods;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        mods.reserve(mods_.size());
+        for (std::size_t i = 0; i < mods_.size(); ++i) {
+            if (!deleted_[i]) {
+                mods.push_back(mods_[i]);
+            }
+        }
+    }
+    for (auto& mod : mods) {
+        consume(std::move(mod));
+    }
+    return true;
+}
+
+bool SyntheticStorage::getModById(int mod_id, std::optional<ModData>& found) {
+    simulateLatency();
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    found.reset();
+    if (exists(mod_id)) {
+        found = mods_[mod_id - 1];
+    }
+    return true;
+}
+
+bool SyntheticStorage::getModsByIds(const std::vector<int>& mod_ids, std::vector<ModData>& found) {
+    simulateLatency();
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    found.clear();
+    for (int mod_id : mod_ids) {
+        if (exists(mod_id)) {
+            found.push_back(mods_[mod_id - 1]);
+        }
+    }
+    return true;
+}
+
+bool SyntheticStorage::exists(int mod_id) const {
+    return mod_id >= 1 && static_cast<std::size_t>(mod_id) <= mods_.size() && !deleted_[mod_id - 1];
+}
+
+CounterWriteStatus SyntheticStorage::addCounters(const std::vector<ModCounterDelta>& deltas) {
+    simulateLatency();
+
+    // Как и в MySQL, счётчики не меняют ревизию: инкрементальное обновление их не видит
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (const auto& delta : deltas) {
+        if (exists(delta.mod_id)) {
+            mods_[delta.mod_id - 1].downloads += delta.downloads;
+            mods_[delta.mod_id - 1].views += delta.views;
+        }
+    }
+    return CounterWriteStatus::Saved;
+}
+
+std::optional<std::string> SyntheticStorage::getServerTime() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return std::to_string(revision_);
+}
+
+void SyntheticStorage::applyChurn() {
+    if (mods_.empty() || options_.churn_per_refresh == 0) {
+        return;
+    }
+
+    ++revision_;
+    std::uniform_int_distribution<std::size_t> pick(0, mods_.size() - 1);
+    for (std::size_t i = 0; i < options_.churn_per_refresh; ++i) {
+        std::size_t index = pick(rng_);
+        if (deleted_[index]) {
+            continue;
+        }
+        mods_[index].description = generateText(options_.description_bytes);
+        revisions_[index] = revision_;
+    }
+}
+
+std::optional<ModChanges> SyntheticStorage::getModChanges(const std::string& since) {
+    simulateLatency();
+
+    std::uint64_t since_revision = 0;
+    try {
+        since_revision = std::stoull(since);
+    } catch (const std::exception&) {
+        log_message("Invalid synthetic watermark: '" + since + "'", "ERROR");
+        return std::nullopt;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    // Каждая инкрементальная выборка видит очередную порцию изменений
+    applyChurn();
+
+    ModChanges changes;
+    changes.watermark = std::to_string(revision_);
+    for (std::size_t i = 0; i < mods_.size(); ++i) {
+        if (revisions_[i] <= since_revision) {
+            continue;
+        }
+        if (deleted_[i]) {
+            changes.deleted.push_back(mods_[i].id);
+        } else {
+            changes.updated.push_back(mods_[i]);
+        }
+    }
+    return changes;
+}
+
+bool SyntheticStorage::applyWrites(const std::vector<ModWrite>& writes, std::vector<ModWriteResult>& results) {
+    simulateLatency();
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    results.assign(writes.size(), ModWriteResult{});
+    // Весь пакет получает одну ревизию, как одна транзакция
+    ++revision_;
+
+    for (std::size_t i = 0; i < writes.size(); ++i) {
+        const auto& write = writes[i];
+        auto& result = results[i];
+        int mod_id = write.id;
+
+        if (write.op == ModWrite::Op::Add) {
+            if (exists(mod_id)) {
+                result.status = ModWriteResult::Status::Conflict;
+                continue;
+            }
+            if (mod_id <= 0) {
+                mod_id = static_cast<int>(mods_.size()) + 1;
+            }
+            // Место под новый id; промежуточные id считаются удалёнными
+            while (mods_.size() < static_cast<std::size_t>(mod_id)) {
+                ModData placeholder;
+                placeholder.id = static_cast<int>(mods_.size()) + 1;
+                mods_.push_back(std::move(placeholder));
+                revisions_.push_back(0);
+                deleted_.push_back(true);
+            }
+            ModData mod;
+            mod.id = mod_id;
+            mod.category = "Общее";
+            merge_mod_write(mod, write);
+            mods_[mod_id - 1] = std::move(mod);
+            deleted_[mod_id - 1] = false;
+        } else if (!exists(mod_id)) {
+            result.status = ModWriteResult::Status::NotFound;
+            continue;
+        } else if (write.op == ModWrite::Op::Update) {
+            merge_mod_write(mods_[mod_id - 1], write);
+        } else {
+            deleted_[mod_id - 1] = true;
+        }
+
+        revisions_[mod_id - 1] = revision_;
+        result.status = ModWriteResult::Status::Ok;
+        if (deleted_[mod_id - 1]) {
+            result.mod.id = mod_id;
+        } else {
+            result.mod = mods_[mod_id - 1];
+        }
+    }
+    return true;
+}
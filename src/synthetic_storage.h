@@ -0,0 +1,60 @@
+#ifndef SYNTHETIC_STORAGE_H
+#define SYNTHETIC_STORAGE_H
+
+#include "mod_storage.h"
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <random>
+#include <vector>
+
+// Параметры сгенерированного каталога
+struct SyntheticStorageOptions {
+    std::size_t mod_count = 10000;
+    // Примерный размер описания мода в байтах
+    std::size_t description_bytes = 512;
+    std::size_t media_per_mod = 3;
+    std::uint32_t seed = 42;
+    // Искусственная задержка каждого обращения, имитирует сетевой round-trip до БД
+    std::chrono::microseconds latency{0};
+    // Сколько модов меняется между инкрементальными обновлениями каталога
+    std::size_t churn_per_refresh = 0;
+};
+
+// Хранилище в памяти с детерминированно сгенерированным каталогом.
+// Позволяет нагружать сетевой путь и сериализацию без MySQL;
+// отметкой для инкрементальных выборок служит счётчик ревизий.
+class SyntheticStorage : public ModStorage {
+public:
+    explicit SyntheticStorage(const SyntheticStorageOptions& options);
+
+    bool connect() override;
+    bool streamAllMods(const ModConsumer& consume) override;
+    bool getModById(int mod_id, std::optional<ModData>& found) override;
+    bool getModsByIds(const std::vector<int>& mod_ids, std::vector<ModData>& found) override;
+    std::optional<std::string> getServerTime() override;
+    std::optional<ModChanges> getModChanges(const std::string& since) override;
+    bool applyWrites(const std::vector<ModWrite>& writes, std::vector<ModWriteResult>& results) override;
+    CounterWriteStatus addCounters(const std::vector<ModCounterDelta>& deltas) override;
+
+private:
+    ModData generateMod(int id);
+    std::string generateText(std::size_t bytes);
+    void applyChurn();
+    void simulateLatency() const;
+
+    SyntheticStorageOptions options_;
+    mutable std::mutex mutex_;
+    std::mt19937 rng_;
+    bool exists(int mod_id) const;
+
+    // Моды лежат по порядку id (id = индекс + 1), revisions_ - ревизия последнего изменения,
+    // deleted_ - мод удалён (место под id остаётся)
+    std::vector<ModData> mods_;
+    std::vector<std::uint64_t> revisions_;
+    std::vector<bool> deleted_;
+    std::uint64_t revision_ = 0;
+};
+
+#endif // SYNTHETIC_STORAGE_H
@@ -0,0 +1,662 @@
+// Массовая загрузка каталога модов в MySQL (таблицы mods и mod_media).
+//
+// Вход - NDJSON (объект мода на строку), JSON-массив модов или CSV с заголовком
+// (столбцы id, name, description, link, category, media; ссылки в media разделяются '|').
+// Вход разбирается потоково и режется на пачки; каждая пачка загружается одной транзакцией
+// многострочными INSERT на одном из параллельных соединений.
+//
+// Использование:
+//   ModImport [--config config.json] [--format ndjson|json|csv] [--batch 1000]
+//             [--connections 4] [--replace] [--dry-run] <файл | ->
+
+#include <mysql.h>
+#include <mysqld_error.h>
+#include <nlohmann/json.hpp>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <mutex>
+#include <optional>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include "logger.h"
+
+using json = nlohmann::json;
+
+namespace {
+
+struct ImportOptions {
+    std::string config_path = "config.json";
+    std::string input = "-";
+    // ndjson, json или csv; пусто - по расширению файла
+    std::string format;
+    // Модов в одной транзакции
+    std::size_t batch_size = 1000;
+    // Ограничение размера пачки, чтобы запрос не упёрся в max_allowed_packet
+    std::size_t batch_bytes = 4 * 1024 * 1024;
+    std::size_t connections = 4;
+    // Существующие моды с теми же id перезаписываются вместе с медиа, иначе дубликат - ошибка пачки
+    bool replace = false;
+    // Только разобрать вход и нарезать пачки, без подключения к БД
+    bool dry_run = false;
+
+    std::string host;
+    std::string user;
+    std::string password;
+    std::string db_name;
+};
+
+struct ImportRow {
+    // 0 - id назначит AUTO_INCREMENT
+    int id = 0;
+    std::string name;
+    std::string description;
+    std::string link;
+    std::string category;
+    std::vector<std::string> media_links;
+
+    std::size_t bytes() const {
+        std::size_t total = name.size() + description.size() + link.size() + category.size() + 64;
+        for (const auto& media : media_links) {
+            total += media.size() + 16;
+        }
+        return total;
+    }
+};
+
+using Batch = std::vector<ImportRow>;
+using RowSink = std::function<void(ImportRow&&)>;
+
+// Очередь пачек между читателем и загрузчиками. Ограничена, чтобы медленная БД
+// не заставляла читатель держать в памяти весь файл
+class BatchQueue {
+public:
+    explicit BatchQueue(std::size_t capacity) : capacity_(capacity) {}
+
+    void push(Batch batch) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        not_full_.wait(lock, [this]() { return queue_.size() < capacity_; });
+        queue_.push_back(std::move(batch));
+        not_empty_.notify_one();
+    }
+
+    // false - очередь закрыта и пуста
+    bool pop(Batch& batch) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        not_empty_.wait(lock, [this]() { return !queue_.empty() || closed_; });
+        if (queue_.empty()) {
+            return false;
+        }
+        batch = std::move(queue_.front());
+        queue_.pop_front();
+        not_full_.notify_one();
+        return true;
+    }
+
+    void close() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        closed_ = true;
+        not_empty_.notify_all();
+    }
+
+private:
+    std::size_t capacity_;
+    std::mutex mutex_;
+    std::condition_variable not_empty_;
+    std::condition_variable not_full_;
+    std::deque<Batch> queue_;
+    bool closed_ = false;
+};
+
+struct ImportStats {
+    std::atomic<std::uint64_t> rows_read{0};
+    std::atomic<std::uint64_t> rows_loaded{0};
+    std::atomic<std::uint64_t> media_loaded{0};
+    std::atomic<std::uint64_t> rows_failed{0};
+    std::atomic<std::uint64_t> batches{0};
+};
+
+// --- Разбор входа ---
+
+bool row_from_json(const json& object, ImportRow& row, std::string& error) {
+    if (!object.is_object()) {
+        error = "expected JSON object";
+        return false;
+    }
+    if (object.contains("id") && !object["id"].is_null()) {
+        if (!object["id"].is_number_integer() || object["id"].get<long long>() <= 0 ||
+            object["id"].get<long long>() > std::numeric_limits<int>::max()) {
+            error = "invalid id";
+            return false;
+        }
+        row.id = object["id"].get<int>();
+    }
+    row.name = object.value("name", "");
+    row.description = object.value("description", "");
+    row.link = object.value("link", "");
+    row.category = object.value("category", "");
+    // Принимаем и формат ответов сервера ("media"), и имя столбца ("media_links")
+    const char* media_key = object.contains("media_links") ? "media_links" : "media";
+    if (object.contains(media_key)) {
+        for (const auto& media : object[media_key]) {
+            if (media.is_string()) {
+                row.media_links.push_back(media.get<std::string>());
+            }
+        }
+    }
+    if (row.name.empty()) {
+        error = "missing name";
+        return false;
+    }
+    return true;
+}
+
+bool read_ndjson(std::istream& in, const RowSink& sink) {
+    std::string line;
+    std::size_t line_number = 0;
+    while (std::getline(in, line)) {
+        ++line_number;
+        if (line.find_first_not_of(" \t\r") == std::string::npos) {
+            continue;
+        }
+        ImportRow row;
+        std::string error;
+        json object = json::parse(line, nullptr, false);
+        if (object.is_discarded() || !row_from_json(object, row, error)) {
+            log_message("Line " + std::to_string(line_number) + ": " +
+                        (object.is_discarded() ? std::string("malformed JSON") : error), "ERROR");
+            return false;
+        }
+        sink(std::move(row));
+    }
+    return true;
+}
+
+bool read_json_array(std::istream& in, const RowSink& sink) {
+    // Элементы массива разбираются по одному и сразу отбрасываются из результата,
+    // поэтому весь каталог в памяти не строится
+    std::size_t index = 0;
+    bool ok = true;
+    json::parser_callback_t callback = [&](int depth, json::parse_event_t event, json& parsed) {
+        if (depth == 1 && event == json::parse_event_t::object_end) {
+            ImportRow row;
+            std::string error;
+            if (ok && !row_from_json(parsed, row, error)) {
+                log_message("Element " + std::to_string(index) + ": " + error, "ERROR");
+                ok = false;
+            }
+            if (ok) {
+                sink(std::move(row));
+            }
+            ++index;
+            return false;
+        }
+        return true;
+    };
+
+    json root = json::parse(in, callback, false);
+    if (root.is_discarded() || !root.is_array()) {
+        log_message("Input is not a JSON array of mods", "ERROR");
+        return false;
+    }
+    return ok;
+}
+
+// Одна запись CSV по RFC 4180: поля в кавычках могут содержать запятые и переводы строк
+bool read_csv_record(std::istream& in, std::vector<std::string>& fields) {
+    fields.clear();
+    std::string field;
+    bool quoted = false;
+    bool any = false;
+    char c;
+    while (in.get(c)) {
+        any = true;
+        if (quoted) {
+            if (c == '"') {
+                if (in.peek() == '"') {
+                    in.get(c);
+                    field += '"';
+                } else {
+                    quoted = false;
+                }
+            } else {
+                field += c;
+            }
+        } else if (c == '"') {
+            quoted = true;
+        } else if (c == ',') {
+            fields.push_back(std::move(field));
+            field.clear();
+        } else if (c == '\n') {
+            break;
+        } else if (c != '\r') {
+            field += c;
+        }
+    }
+    if (any) {
+        fields.push_back(std::move(field));
+    }
+    return any;
+}
+
+bool read_csv(std::istream& in, const RowSink& sink) {
+    std::vector<std::string> header;
+    if (!read_csv_record(in, header)) {
+        log_message("Empty CSV input", "ERROR");
+        return false;
+    }
+
+    enum Column { ID, NAME, DESCRIPTION, LINK, CATEGORY, MEDIA, COLUMN_COUNT };
+    static const char* const NAMES[COLUMN_COUNT] = {"id", "name", "description", "link", "category", "media"};
+    int index[COLUMN_COUNT];
+    std::fill(std::begin(index), std::end(index), -1);
+    for (std::size_t i = 0; i < header.size(); ++i) {
+        for (int column = 0; column < COLUMN_COUNT; ++column) {
+            if (header[i] == NAMES[column] || (column == MEDIA && header[i] == "media_links")) {
+                index[column] = static_cast<int>(i);
+            }
+        }
+    }
+    if (index[NAME] < 0) {
+        log_message("CSV header has no 'name' column", "ERROR");
+        return false;
+    }
+
+    std::vector<std::string> fields;
+    std::size_t record = 1;
+    while (read_csv_record(in, fields)) {
+        ++record;
+        if (fields.size() == 1 && fields[0].empty()) {
+            continue;
+        }
+        auto field = [&](Column column) -> std::string {
+            int i = index[column];
+            return i >= 0 && static_cast<std::size_t>(i) < fields.size() ? fields[i] : std::string();
+        };
+
+        ImportRow row;
+        std::string id = field(ID);
+        if (!id.empty()) {
+            try {
+                row.id = std::stoi(id);
+            } catch (const std::exception&) {
+                row.id = -1;
+            }
+            if (row.id <= 0) {
+                log_message("Record " + std::to_string(record) + ": invalid id '" + id + "'", "ERROR");
+                return false;
+            }
+        }
+        row.name = field(NAME);
+        row.description = field(DESCRIPTION);
+        row.link = field(LINK);
+        row.category = field(CATEGORY);
+        std::istringstream media(field(MEDIA));
+        std::string link;
+        while (std::getline(media, link, '|')) {
+            if (!link.empty()) {
+                row.media_links.push_back(link);
+            }
+        }
+        if (row.name.empty()) {
+            log_message("Record " + std::to_string(record) + ": missing name", "ERROR");
+            return false;
+        }
+        sink(std::move(row));
+    }
+    return true;
+}
+
+// --- Загрузка ---
+
+std::string quoted(MYSQL* mysql, const std::string& value) {
+    std::string escaped(value.size() * 2 + 1, '\0');
+    escaped.resize(mysql_real_escape_string(mysql, &escaped[0], value.c_str(),
+                                            static_cast<unsigned long>(value.size())));
+    return "'" + escaped + "'";
+}
+
+bool execute(MYSQL* mysql, const std::string& query) {
+    if (mysql_query(mysql, query.c_str())) {
+        log_message("Error executing query: " + std::string(mysql_error(mysql)), "ERROR");
+        return false;
+    }
+    return true;
+}
+
+MYSQL* connect(const ImportOptions& options) {
+    MYSQL* mysql = mysql_init(nullptr);
+    if (!mysql) {
+        log_message("Error initializing MySQL", "ERROR");
+        return nullptr;
+    }
+    int timeout = 5;
+    mysql_options(mysql, MYSQL_OPT_CONNECT_TIMEOUT, &timeout);
+    mysql_options(mysql, MYSQL_SET_CHARSET_NAME, "utf8mb4");
+    if (!mysql_real_connect(mysql, options.host.c_str(), options.user.c_str(), options.password.c_str(),
+                            options.db_name.c_str(), 0, nullptr, 0)) {
+        log_message("Failed to connect to database: " + std::string(mysql_error(mysql)), "ERROR");
+        mysql_close(mysql);
+        return nullptr;
+    }
+    return mysql;
+}
+
+// Пачка одной транзакцией: моды с id одним INSERT, моды без id (AUTO_INCREMENT) - по одному, затем их медиа.
+// updated_at выставляется, чтобы работающие серверы подхватили моды инкрементальным обновлением
+bool load_batch(MYSQL* mysql, const Batch& batch, const ImportOptions& options, std::uint64_t& media_count) {
+    auto values = [mysql](const ImportRow& row) {
+        return quoted(mysql, row.name) + "," + quoted(mysql, row.description) + "," + quoted(mysql, row.link) + "," +
+               (row.category.empty() ? std::string("NULL") : quoted(mysql, row.category)) + ",NOW(6)";
+    };
+
+    std::string explicit_rows;
+    std::string explicit_ids;
+    for (const auto& row : batch) {
+        if (row.id > 0) {
+            if (!explicit_rows.empty()) {
+                explicit_rows += ",";
+                explicit_ids += ",";
+            }
+            explicit_rows += "(" + std::to_string(row.id) + "," + values(row) + ")";
+            explicit_ids += std::to_string(row.id);
+        }
+    }
+
+    if (!execute(mysql, "START TRANSACTION")) {
+        return false;
+    }
+    if (!explicit_rows.empty()) {
+        if (options.replace &&
+            !execute(mysql, "DELETE FROM mod_media WHERE mod_id IN (" + explicit_ids + ")")) {
+            return false;
+        }
+        std::string query = "INSERT INTO mods (id, name, description, link, category, updated_at) VALUES " +
+                            explicit_rows;
+        if (options.replace) {
+            query += " ON DUPLICATE KEY UPDATE name = VALUES(name), description = VALUES(description), "
+                     "link = VALUES(link), category = VALUES(category), updated_at = VALUES(updated_at)";
+        }
+        if (!execute(mysql, query)) {
+            return false;
+        }
+    }
+
+    // id новых модов берём из mysql_insert_id каждой строки: у многострочного INSERT они не обязаны
+    // идти подряд (auto_increment_increment, innodb_autoinc_lock_mode=2 при параллельных загрузчиках).
+    // В саму пачку id не записываем: после отката и повтора они были бы уже недействительны
+    std::vector<int> ids;
+    ids.reserve(batch.size());
+    for (const auto& row : batch) {
+        if (row.id > 0) {
+            ids.push_back(row.id);
+            continue;
+        }
+        if (!execute(mysql, "INSERT INTO mods (name, description, link, category, updated_at) VALUES (" +
+                            values(row) + ")")) {
+            return false;
+        }
+        ids.push_back(static_cast<int>(mysql_insert_id(mysql)));
+    }
+
+    std::string media;
+    std::uint64_t links = 0;
+    for (std::size_t i = 0; i < batch.size(); ++i) {
+        for (const auto& link : batch[i].media_links) {
+            if (!media.empty()) media += ",";
+            media += "(" + std::to_string(ids[i]) + "," + quoted(mysql, link) + ")";
+            ++links;
+        }
+    }
+    if (!media.empty() && !execute(mysql, "INSERT INTO mod_media (mod_id, media_link) VALUES " + media)) {
+        return false;
+    }
+    if (!execute(mysql, "COMMIT")) {
+        return false;
+    }
+    media_count = links;
+    return true;
+}
+
+void run_loader(const ImportOptions& options, BatchQueue& queue, ImportStats& stats) {
+    MYSQL* mysql = options.dry_run ? nullptr : connect(options);
+    if (!options.dry_run && !mysql) {
+        // Без соединения пачки всё равно нужно забирать, иначе читатель встанет
+        Batch batch;
+        while (queue.pop(batch)) {
+            stats.rows_failed += batch.size();
+        }
+        return;
+    }
+
+    Batch batch;
+    while (queue.pop(batch)) {
+        std::uint64_t media = 0;
+        bool ok = true;
+        if (options.dry_run) {
+            for (const auto& row : batch) {
+                media += row.media_links.size();
+            }
+        } else {
+            // Взаимная блокировка с другим загрузчиком - повод повторить, а не терять пачку
+            for (int attempt = 0; attempt < 3; ++attempt) {
+                ok = load_batch(mysql, batch, options, media);
+                if (ok) {
+                    break;
+                }
+                unsigned int err = mysql_errno(mysql);
+                mysql_query(mysql, "ROLLBACK");
+                if (err != ER_LOCK_DEADLOCK && err != ER_LOCK_WAIT_TIMEOUT) {
+                    break;
+                }
+            }
+        }
+
+        if (ok) {
+            stats.rows_loaded += batch.size();
+            stats.media_loaded += media;
+        } else {
+            stats.rows_failed += batch.size();
+            log_message("Batch of " + std::to_string(batch.size()) + " mods failed (first id " +
+                        std::to_string(batch.front().id) + ")", "ERROR");
+        }
+        ++stats.batches;
+    }
+
+    if (mysql) {
+        mysql_close(mysql);
+    }
+}
+
+std::string format_rate(std::uint64_t rows, double seconds) {
+    std::ostringstream out;
+    out << std::fixed << std::setprecision(0) << (seconds > 0 ? static_cast<double>(rows) / seconds : 0.0);
+    return out.str();
+}
+
+void print_usage() {
+    std::cerr << "Usage: ModImport [--config config.json] [--format ndjson|json|csv] [--batch N]\n"
+                 "                 [--batch-bytes N] [--connections N] [--replace] [--dry-run] <file | ->\n";
+}
+
+bool parse_arguments(int argc, char* argv[], ImportOptions& options) {
+    bool have_input = false;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        auto next = [&]() -> std::string { return i + 1 < argc ? argv[++i] : std::string(); };
+        try {
+            if (arg == "--config") {
+                options.config_path = next();
+            } else if (arg == "--format") {
+                options.format = next();
+            } else if (arg == "--batch") {
+                options.batch_size = std::stoul(next());
+            } else if (arg == "--batch-bytes") {
+                options.batch_bytes = std::stoul(next());
+            } else if (arg == "--connections") {
+                options.connections = std::stoul(next());
+            } else if (arg == "--replace") {
+                options.replace = true;
+            } else if (arg == "--dry-run") {
+                options.dry_run = true;
+            } else if (arg == "--help" || arg == "-h") {
+                return false;
+            } else if (!have_input && (arg == "-" || arg[0] != '-')) {
+                options.input = arg;
+                have_input = true;
+            } else {
+                std::cerr << "Unknown argument: " << arg << "\n";
+                return false;
+            }
+        } catch (const std::exception&) {
+            std::cerr << "Invalid value for " << arg << "\n";
+            return false;
+        }
+    }
+
+    if (options.format.empty()) {
+        auto ends_with = [&](const std::string& suffix) {
+            return options.input.size() >= suffix.size() &&
+                   options.input.compare(options.input.size() - suffix.size(), suffix.size(), suffix) == 0;
+        };
+        options.format = ends_with(".csv") ? "csv" : ends_with(".json") ? "json" : "ndjson";
+    }
+    if (options.format != "ndjson" && options.format != "json" && options.format != "csv") {
+        std::cerr << "Unknown format: " << options.format << "\n";
+        return false;
+    }
+    options.batch_size = std::max<std::size_t>(options.batch_size, 1);
+    options.connections = std::max<std::size_t>(options.connections, 1);
+    return have_input;
+}
+
+bool load_config(ImportOptions& options) {
+    std::ifstream config_file(options.config_path);
+    if (!config_file.is_open()) {
+        log_message("Cannot open config " + options.config_path, "ERROR");
+        return false;
+    }
+    json config = json::parse(config_file, nullptr, false);
+    if (config.is_discarded() || !config.contains("database")) {
+        log_message("Config " + options.config_path + " has no 'database' section", "ERROR");
+        return false;
+    }
+    const auto& database = config["database"];
+    options.host = database.value("host", "localhost");
+    options.user = database.value("user", "");
+    options.password = database.value("password", "");
+    options.db_name = database.value("dbname", "");
+    return true;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    ImportOptions options;
+    if (!parse_arguments(argc, argv, options)) {
+        print_usage();
+        return 2;
+    }
+    if (!options.dry_run && !load_config(options)) {
+        return 1;
+    }
+
+    std::ifstream file;
+    if (options.input != "-") {
+        file.open(options.input, std::ios::binary);
+        if (!file.is_open()) {
+            log_message("Cannot open input " + options.input, "ERROR");
+            return 1;
+        }
+    }
+    std::istream& in = options.input == "-" ? std::cin : file;
+
+    if (!options.dry_run) {
+        mysql_library_init(0, nullptr, nullptr);
+    }
+
+    ImportStats stats;
+    BatchQueue queue(options.connections * 2);
+    std::vector<std::thread> loaders;
+    for (std::size_t i = 0; i < options.connections; ++i) {
+        loaders.emplace_back([&]() { run_loader(options, queue, stats); });
+    }
+
+    auto started = std::chrono::steady_clock::now();
+    auto elapsed = [&started]() {
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+    };
+
+    // Прогресс раз в секунду, пока идёт загрузка
+    std::mutex progress_mutex;
+    std::condition_variable progress_cv;
+    bool done = false;
+    std::thread progress([&]() {
+        std::uint64_t last = 0;
+        std::unique_lock<std::mutex> lock(progress_mutex);
+        while (!progress_cv.wait_for(lock, std::chrono::seconds(1), [&done]() { return done; })) {
+            std::uint64_t loaded = stats.rows_loaded;
+            log_message("Loaded " + std::to_string(loaded) + " of " + std::to_string(stats.rows_read.load()) +
+                        " mods read, " + std::to_string(loaded - last) + " mods/sec", "INFO");
+            last = loaded;
+        }
+    });
+
+    Batch batch;
+    std::size_t batch_bytes = 0;
+    RowSink sink = [&](ImportRow&& row) {
+        ++stats.rows_read;
+        batch_bytes += row.bytes();
+        batch.push_back(std::move(row));
+        if (batch.size() >= options.batch_size || batch_bytes >= options.batch_bytes) {
+            queue.push(std::move(batch));
+            batch = Batch();
+            batch.reserve(options.batch_size);
+            batch_bytes = 0;
+        }
+    };
+
+    bool parsed = options.format == "csv" ? read_csv(in, sink)
+                : options.format == "json" ? read_json_array(in, sink)
+                : read_ndjson(in, sink);
+    if (!batch.empty()) {
+        queue.push(std::move(batch));
+    }
+    queue.close();
+
+    for (auto& loader : loaders) {
+        loader.join();
+    }
+    {
+        std::lock_guard<std::mutex> lock(progress_mutex);
+        done = true;
+    }
+    progress_cv.notify_one();
+    progress.join();
+
+    double seconds = elapsed();
+    log_message(std::string(options.dry_run ? "Dry run: parsed " : "Imported ") +
+                std::to_string(stats.rows_loaded.load()) + " mods and " + std::to_string(stats.media_loaded.load()) +
+                " media links in " + std::to_string(stats.batches.load()) + " batches, " +
+                std::to_string(static_cast<long long>(seconds * 1000)) + " ms (" +
+                format_rate(stats.rows_loaded, seconds) + " mods/sec, " +
+                format_rate(stats.media_loaded, seconds) + " media/sec)", "INFO");
+    if (stats.rows_failed > 0) {
+        log_message(std::to_string(stats.rows_failed.load()) + " mods failed to load", "ERROR");
+    }
+
+    if (!options.dry_run) {
+        mysql_library_end();
+    }
+    return parsed && stats.rows_failed == 0 ? 0 : 1;
+}